@@ -0,0 +1,44 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <core/gmpoint>
+
+#include <algorithm>
+
+// Axis aligned bounding box used by the collision broad phase
+struct Aabb {
+  GMlib::Point<float,3>   lo;
+  GMlib::Point<float,3>   hi;
+
+  bool overlaps(const Aabb& other) const {
+
+    for( int k = 0; k < 3; ++k )
+      if( lo(k) > other.hi(k) || hi(k) < other.lo(k) )
+        return false;
+    return true;
+  }
+
+  // smallest box holding both
+  static Aabb merge(const Aabb& a, const Aabb& b) {
+
+    Aabb box;
+    for( int k = 0; k < 3; ++k ) {
+      box.lo[k] = std::min(a.lo(k), b.lo(k));
+      box.hi[k] = std::max(a.hi(k), b.hi(k));
+    }
+    return box;
+  }
+
+  // box around a sphere of radius r moving from p to p+ds during the frame
+  static Aabb swept(const GMlib::Point<float,3>& p, const GMlib::Point<float,3>& ds, float r) {
+
+    Aabb box;
+    for( int k = 0; k < 3; ++k ) {
+      box.lo[k] = std::min(p(k), p(k) + ds(k)) - r;
+      box.hi[k] = std::max(p(k), p(k) + ds(k)) + r;
+    }
+    return box;
+  }
+};
+
+#endif // AABB_H
@@ -0,0 +1,112 @@
+#include "aabbtree.h"
+
+// stl
+#include <algorithm>
+
+
+int AabbTree::size() const {
+
+  return int(_ids.size());
+}
+
+void AabbTree::build(const std::vector<Aabb>& boxes) {
+
+  _boxes = boxes;
+  _nodes.clear();
+  _ids.resize(boxes.size());
+  for( size_t i = 0; i < boxes.size(); ++i )
+    _ids[i] = int(i);
+
+  if( !boxes.empty() ) {
+    _nodes.push_back(Node());
+    buildNode(boxes, 0, 0, int(boxes.size()));
+  }
+}
+
+void AabbTree::buildNode(const std::vector<Aabb>& boxes, int node, int begin, int end) {
+
+  Aabb box = boxes[_ids[begin]];
+  for( int i = begin + 1; i < end; ++i )
+    box = Aabb::merge(box, boxes[_ids[i]]);
+  _nodes[node].box = box;
+  _nodes[node].begin = begin;
+  _nodes[node].end = end;
+
+  if( end - begin <= LeafSize ) {
+    _nodes[node].left = -1;
+    return;
+  }
+
+  // split the centers at the median of the longest axis
+  int axis = 0;
+  for( int k = 1; k < 3; ++k )
+    if( box.hi(k) - box.lo(k) > box.hi(axis) - box.lo(axis) )
+      axis = k;
+
+  const int mid = (begin + end) / 2;
+  std::nth_element(_ids.begin() + begin, _ids.begin() + mid, _ids.begin() + end,
+                   [&boxes, axis](int a, int b) {
+                     return boxes[a].lo(axis) + boxes[a].hi(axis) < boxes[b].lo(axis) + boxes[b].hi(axis);
+                   });
+
+  // children are stored next to each other
+  const int left = int(_nodes.size());
+  _nodes[node].left = left;
+  _nodes.push_back(Node());
+  _nodes.push_back(Node());
+
+  buildNode(boxes, left, begin, mid);
+  buildNode(boxes, left + 1, mid, end);
+}
+
+void AabbTree::refit(const std::vector<Aabb>& boxes) {
+
+  if( int(boxes.size()) != size() ) {
+    build(boxes);
+    return;
+  }
+  _boxes = boxes;
+  if( !_nodes.empty() )
+    refitNode(boxes, 0);
+}
+
+Aabb AabbTree::refitNode(const std::vector<Aabb>& boxes, int node) {
+
+  Node& n = _nodes[node];
+  if( n.left < 0 ) {
+    n.box = boxes[_ids[n.begin]];
+    for( int i = n.begin + 1; i < n.end; ++i )
+      n.box = Aabb::merge(n.box, boxes[_ids[i]]);
+  }
+  else
+    n.box = Aabb::merge(refitNode(boxes, n.left), refitNode(boxes, n.left + 1));
+  return n.box;
+}
+
+void AabbTree::query(const Aabb& box, std::vector<int>& result) const {
+
+  if( _nodes.empty() )
+    return;
+
+  // median splits keep the tree balanced, 64 levels is far more than it can get
+  int stack[64];
+  int top = 0;
+  stack[top++] = 0;
+
+  while( top > 0 ) {
+
+    const Node& n = _nodes[stack[--top]];
+    if( !n.box.overlaps(box) )
+      continue;
+
+    if( n.left < 0 ) {
+      for( int i = n.begin; i < n.end; ++i )
+        if( _boxes[_ids[i]].overlaps(box) )
+          result.push_back(_ids[i]);
+    }
+    else {
+      stack[top++] = n.left;
+      stack[top++] = n.left + 1;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include "aabb.h"
+
+// stl
+#include <vector>
+
+
+// Static bounding volume hierarchy over a set of boxes, split at the median of
+// the longest axis. Built once for objects that rarely change, like the walls.
+// When they move refit() recomputes the node boxes without changing the tree.
+class AabbTree {
+public:
+  void                  build( const std::vector<Aabb>& boxes );
+  void                  refit( const std::vector<Aabb>& boxes );
+
+  // ids of the boxes overlapping box, appended to result
+  void                  query( const Aabb& box, std::vector<int>& result ) const;
+
+  int                   size() const;
+
+private:
+  struct Node {
+    Aabb                box;
+    int                 left;     // first child, the second one follows it, -1 for a leaf
+    int                 begin;    // leaf: range of _ids
+    int                 end;
+  };
+
+  static const int      LeafSize = 4;
+
+  std::vector<Node>     _nodes;
+  std::vector<int>      _ids;
+  std::vector<Aabb>     _boxes;
+
+  void                  buildNode( const std::vector<Aabb>& boxes, int node, int begin, int end );
+  Aabb                  refitNode( const std::vector<Aabb>& boxes, int node );
+
+}; // END class AabbTree
+
+#endif // AABBTREE_H
@@ -0,0 +1,40 @@
+#include "alloccounter.h"
+
+// stl
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+
+  std::atomic<long> allocations {0};
+  std::atomic<bool> counting {false};
+
+}
+
+void AllocCounter::start() {
+
+  allocations = 0;
+  counting = true;
+}
+
+long AllocCounter::stop() {
+
+  counting = false;
+  return allocations;
+}
+
+void* operator new(std::size_t size) {
+
+  if( counting.load(std::memory_order_relaxed) )
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  if( void* p = std::malloc(size ? size : 1) )
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+
+  std::free(p);
+}
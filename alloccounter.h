@@ -0,0 +1,14 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+// Counts calls to the global operator new, for BallSimHeadless --check-alloc.
+// The replacement operators live in alloccounter.cpp, which only the headless
+// driver links.
+namespace AllocCounter {
+
+  void    start();
+  long    stop();   // allocations since start()
+
+} // END namespace AllocCounter
+
+#endif // ALLOCCOUNTER_H
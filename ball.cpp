@@ -1,17 +1,15 @@
 #include "ball.h"
 
-#include <QDebug>
-
-  Ball::Ball(double radius, double mass, GMlib::Vector<float,3> velocity, GMlib::PBezierSurf<float>* surface)
+  Ball::Ball(double radius, double mass, GMlib::Vector<float,3> velocity)
       :GMlib::PSphere<float>(radius)
   {
       this->_radius = radius;
       this->_mass = mass;
       this->_velocity = velocity;
-      this->_surface = surface;
-      this->_x=0;
-
-      this->_surface->estimateClpPar(this->getPos(),_u,_v); //evaluating _u, _v
+      this->_dS = GMlib::Vector<float,3>(0,0,0);
+      this->_surfNormal = GMlib::Vector<float,3>(0,0,1);
+      this->_index = -1;
+      this->_commands = nullptr;
   }
 
   Ball::~Ball() {}
@@ -20,7 +18,15 @@
 
     void Ball::setVelocity(const GMlib::Vector<float,3> velocity)
     {
-        _velocity = velocity;
+        _velocity = velocity; //until the next frame is shown
+        if (_commands)
+        {
+            int h = _index;
+            _commands->post([h, velocity](BallStore& store)
+            {
+                if (store.isValid(h)) store.setVelocity(store.getSlot(h), velocity); //removed since the post
+            });
+        }
     }
 
     GMlib::Vector<float,3> Ball::getVelocity()
@@ -30,7 +36,7 @@
 
     double Ball::getMass()
     {
-        return _mass;
+        return _mass; //the store never changes it
     }
 
     GMlib::Vector<float,3> Ball::getDs()
@@ -38,177 +44,110 @@
         return _dS;
     }
 
-//    void Ball::setLocation(GMlib::Point<float,3> &location)
-//    {
-//        _location = location;
-//        translate(location+_velocity); //point1 = vector + point2
-//    }
-
-    void Ball::updateX(double x)
+    GMlib::Vector<float,3> Ball::getSurfNormal()
     {
-        _x=x;
+        return _surfNormal;
     }
 
-    double Ball::getX()
+    void Ball::attach(int index, CommandQueue* commands)
     {
-        return _x;
+        _index = index;
+        _commands = commands;
     }
 
-    void Ball::setUV(GMlib::PBezierSurf<float>* surface)
+    void Ball::detach()
     {
-        surface->estimateClpPar(this->getPos(), _u, _v);
+        _index = -1;
+        _commands = nullptr;
     }
 
-    GMlib::Vector<float,3> Ball::getSurfNormal()
+    void Ball::place(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, double mass)
     {
-        _surface->getClosestPoint(this->getPos(),_u,_v);
-        GMlib::DMatrix<GMlib::Vector<float,3>> sMatrix = _surface->evaluate(_u,_v, 1,1);
-        GMlib::UnitVector<float,3> norm = sMatrix[0][1] ^ sMatrix[1][0];
-        return norm;
+        this->translateParent(pos - this->getPos());
+        _velocity = velocity;
+        _mass = mass;
+        _dS = GMlib::Vector<float,3>(0,0,0);
     }
 
-    void Ball::computeStep(double dt)
+    int Ball::getIndex() const
     {
-        static auto g = GMlib::Vector<float,3>(0,0,-9.8);
-        _dS = dt * _velocity + 0.5 * dt * dt * g;
-
-        _surface->getClosestPoint(this->getPos()+_dS,_u,_v);// _p = this->getPos()+_dS
-
-        GMlib::DMatrix<GMlib::Vector<float,3>> sMatrix =_surface->evaluate(_u,_v,1,1);
-        GMlib::UnitVector<float,3> norm = sMatrix[0][1] ^ sMatrix[1][0];  //norm.normalize();
-
-        _dS = sMatrix[0][0]+(_radius*norm)-this->getPos();
-
-        double checkV1 = _velocity*_velocity + 2.0*(g*_dS); //
-
-        _velocity+=dt*g;
-        _velocity-=(_velocity*norm)*norm; // _velocity+=(norm*_velocity)*norm;
-
-        double checkV2 = _velocity*_velocity; //
-
-        if(checkV2 > 0.0001) //
-        { //
-            if(checkV1 > 0.0001) //
-            {
-                _velocity *= std::sqrt(checkV1/checkV2); // vector correction 1
-            }
-        } //
+        return _index;
     }
 
-    void Ball::moveUp()
+    //speeds the ball up along one axis (dir is +1 or -1) and slows down the other one
+    static void steerVelocity(GMlib::Vector<float,3>& newVelVect, int axis, float dir)
     {
-        GMlib::Vector<float,3> newVelVect = this->getVelocity();
-        if (newVelVect[1] < 8.0 && newVelVect[1] > -8.0)
+        const int other = 1 - axis;
+        if (newVelVect[axis] < 8.0 && newVelVect[axis] > -8.0)
         {
-            if (newVelVect[1] < 0.0)
+            if (newVelVect[axis] * dir < 0.0)
             {
-                newVelVect[1] = 0.0;
+                newVelVect[axis] = 0.0;
             }
 
-            newVelVect[1] += 1.0;
-            newVelVect[0] *= 0.5;
+            newVelVect[axis] += dir;
+            newVelVect[other] *= 0.5;
             //newVelVect[2] *= 0.5;
-
-            this->setVelocity(newVelVect);
-
-//        qDebug() << newVelVect[0];
-//        qDebug() << "";
-//        qDebug() << newVelVect[1];
-//        qDebug() << "";
-//        qDebug() << newVelVect[2];
-//        qDebug() << "--------------";
         }
         else
         {
-            while (newVelVect[1] >= 8.0 || newVelVect[1] <= -8.0)
+            while (newVelVect[axis] >= 8.0 || newVelVect[axis] <= -8.0)
             {
-                newVelVect[1] *= 0.9;
-                this->setVelocity(newVelVect);
+                newVelVect[axis] *= 0.9;
             }
         }
     }
-    void Ball::moveDown()
+
+    void Ball::steer(int axis, float dir)
     {
-        GMlib::Vector<float,3> newVelVect = this->getVelocity();
-        if (newVelVect[1] < 8.0 && newVelVect[1] > -8.0)
+        if (_commands) //read and write the velocity on the simulation side
         {
-            if (newVelVect[1] > 0.0)
+            int h = _index;
+            _commands->post([h, axis, dir](BallStore& store)
             {
-                newVelVect[1] = 0.0;
-            }
-
-            newVelVect[1] -= 1.0;
-            newVelVect[0] *= 0.5;
-            //newVelVect[2] *= 0.5;
-
-            this->setVelocity(newVelVect);
+                if (!store.isValid(h)) return; //removed since the post
+                const int i = store.getSlot(h); //the store may have been reordered since the post
+                GMlib::Vector<float,3> newVelVect = store.getVelocity(i);
+                steerVelocity(newVelVect, axis, dir);
+                store.setVelocity(i, newVelVect);
+            });
         }
         else
         {
-            while (newVelVect[1] >= 8.0 || newVelVect[1] <= -8.0)
-            {
-                newVelVect[1] *= 0.9;
-                this->setVelocity(newVelVect);
-            }
+            GMlib::Vector<float,3> newVelVect = this->getVelocity();
+            steerVelocity(newVelVect, axis, dir);
+            this->setVelocity(newVelVect);
         }
     }
+
+    void Ball::moveUp()
+    {
+        steer(1, 1.0f);
+    }
+    void Ball::moveDown()
+    {
+        steer(1, -1.0f);
+    }
     void Ball::moveRight()
     {
-        GMlib::Vector<float,3> newVelVect = this->getVelocity();
-        if (newVelVect[0] < 8.0 && newVelVect[0] > -8.0)
-        {
-            if (newVelVect[0] < 0.0)
-            {
-                newVelVect[0] = 0.0;
-            }
-
-            newVelVect[0] += 1.0;
-            newVelVect[1] *= 0.5;
-            //newVelVect[2] *= 0.5;
-
-            this->setVelocity(newVelVect);
-        }
-        else
-        {
-            while (newVelVect[0] >= 8.0 || newVelVect[0] <= -8.0)
-            {
-                newVelVect[0] *= 0.9;
-                this->setVelocity(newVelVect);
-            }
-        }
+        steer(0, 1.0f);
     }
     void Ball::moveLeft()
     {
-        GMlib::Vector<float,3> newVelVect = this->getVelocity();
-        if (newVelVect[0] < 8.0 && newVelVect[0] > -8.0)
-        {
-            if (newVelVect[0] > 0.0)
-            {
-                newVelVect[0] = 0.0;
-            }
-
-            newVelVect[0] -= 1.0;
-            newVelVect[1] *= 0.5;
-            //newVelVect[2] *= 0.5;
-
-            this->setVelocity(newVelVect);
-        }
-        else
-        {
-            while (newVelVect[0] >= 8.0 || newVelVect[0] <= -8.0)
-            {
-                newVelVect[0] *= 0.9;
-                this->setVelocity(newVelVect);
-            }
-        }
+        steer(0, -1.0f);
     }
 
-  void Ball::localSimulate(double dt)
+  void Ball::showAt(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& normal,
+                    const GMlib::Vector<float,3>& velocity, const GMlib::Vector<float,3>& ds)
   {
-    rotateGlobal(GMlib::Angle(_dS.getLength()/this->getRadius()), this->getSurfNormal()^_dS);
-    //rotateParent(_dS.getLength(), this->getGlobalPos(), this->getSurfNormal()^_dS);
-    this->translateParent(_dS);
+    _velocity = velocity;
+    _dS = ds;
+    _surfNormal = normal;
 
-    //computeStep(dt);
+    GMlib::Vector<float,3> move = pos - this->getPos();
+    if (move.getLength() > 0.0)
+    {
+        rotateGlobal(GMlib::Angle(move.getLength()/this->getRadius()), normal^move); //rolling
+        this->translateParent(move);
+    }
   }
-
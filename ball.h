@@ -4,15 +4,20 @@
 #include <parametrics/gmpsphere>
 #include "gmpbiplane.h"
 #include "gmpcurplane.h"
+#include "ballstore.h"
+#include "commandqueue.h"
 #include <gmParametricsModule>
 
-#include <QDebug>
-
+// Scene object showing one ball of a BallStore. The state lives in the store
+// once the ball is inserted in a Controller, before that it keeps the initial values.
+// Setters and moves are posted to the controller's CommandQueue once attached, the
+// getters return the state of the frame last shown, the store may be simulated on
+// another thread.
 class Ball : public GMlib::PSphere<float> {
     GM_SCENEOBJECT(Ball)
 
 public:
-  Ball(double radius, double mass, GMlib::Vector<float,3> velocity, GMlib::PBezierSurf<float>* surface);
+  Ball(double radius, double mass, GMlib::Vector<float,3> velocity);
   ~Ball();
 
 //methods for ball properties
@@ -21,38 +26,31 @@ public:
     GMlib::Vector<float,3> getVelocity();
     double getMass();
     GMlib::Vector<float,3> getDs();
-//  void setLocation(GMlib::Point<float,3> &location);
-
-    void updateX(double x);
-    double getX();
 
     GMlib::Vector<float,3> getSurfNormal();
-    void setUV(GMlib::PBezierSurf<float>* surface);
 
-    void computeStep(double dt);
+    void attach(int index, CommandQueue* commands);
+    void detach(); //keeps the state last shown
+    void place(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, double mass); //before insertBall
+    int getIndex() const; //handle in the store, stays the same when the store is reordered
+    void showAt(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& normal,
+                const GMlib::Vector<float,3>& velocity, const GMlib::Vector<float,3>& ds);
 
     void moveUp();
     void moveDown();
     void moveRight();
     void moveLeft();
 
-protected:
-  void localSimulate(double dt);
-
 private:
   GMlib::Vector<float,3> _velocity;
   double _mass;
-
   GMlib::Vector<float,3> _dS;
-  float _u;
-  float _v;
-
-  double _x;
+  GMlib::Vector<float,3> _surfNormal;
 
-  GMlib::PBezierSurf<float>* _surface;
-  //std::shared_ptr<PBiPlane<float>> _surface;
+  int _index;
+  CommandQueue* _commands; //changes go through here once attached
 
-  //GMlib::Point<float,3> _p;
+  void steer(int axis, float dir);
 
 }; // END class ball
 
@@ -75,4 +73,3 @@ private:
 //-DCMAKE_BUILD_TYPE=Release //-DBUILD_TYPE=Release
 //-DCMAKE_BUILD_TYPE=debug
 //-DGM_DEBUG_OPENGL=on
-
@@ -0,0 +1,69 @@
+#include "ballpool.h"
+
+
+BallPool::BallPool(Controller* controller, GMlib::PSurfVisualizer<float,3>* visualizer, float radius,
+                   const GMlib::Material& material, int samples)
+  : _controller{controller}, _visualizer{visualizer}, _radius{radius}, _material{material}, _samples{samples} {}
+
+// balls still in the scene are left to it
+BallPool::~BallPool() {
+
+  for( Ball* ball : _free )
+    delete ball;
+}
+
+void BallPool::reserve(int count) {
+
+  _free.reserve(count);
+  while( int(_free.size()) < count )
+    _free.push_back(make());
+}
+
+Ball* BallPool::acquire(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, double mass) {
+
+  Ball* ball;
+  if( _free.empty() ) {
+    ball = make();
+    _misses++;
+  }
+  else {
+    ball = _free.back();
+    _free.pop_back();
+  }
+
+  ball->place(pos, velocity, mass);
+  _controller->insertBall(ball);
+  _active++;
+  return ball;
+}
+
+void BallPool::release(Ball* ball) {
+
+  _controller->removeBall(ball);
+  _free.push_back(ball);
+  _active--;
+}
+
+int BallPool::getFreeCount() const {
+
+  return int(_free.size());
+}
+
+int BallPool::getActiveCount() const {
+
+  return _active;
+}
+
+long BallPool::getMissCount() const {
+
+  return _misses;
+}
+
+Ball* BallPool::make() {
+
+  Ball* ball = new Ball(_radius, 1.0, GMlib::Vector<float,3>(0,0,0));
+  ball->insertVisualizer(_visualizer);
+  ball->replot(_samples, _samples, 1, 1);
+  ball->setMaterial(_material);
+  return ball;
+}
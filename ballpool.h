@@ -0,0 +1,46 @@
+#ifndef BALLPOOL_H
+#define BALLPOOL_H
+
+#include "ball.h"
+#include "controller.h"
+
+#include <gmSceneModule>
+
+// stl
+#include <vector>
+
+
+// Ball scene objects made ahead of time, with visualizer, tessellation and material
+// done, for spawners on the GUI thread. acquire() only places a free ball and inserts
+// it in the controller, release() takes it out again for a later acquire(). Making a
+// ball replots it, so reserve() and an acquire() that misses need the GL context.
+class BallPool {
+public:
+  BallPool( Controller* controller, GMlib::PSurfVisualizer<float,3>* visualizer, float radius,
+            const GMlib::Material& material, int samples = 100 );
+  ~BallPool();
+
+  void                  reserve( int count );   // makes balls until count are free
+  Ball*                 acquire( const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, double mass );
+  void                  release( Ball* ball );
+
+  int                   getFreeCount() const;
+  int                   getActiveCount() const;
+  long                  getMissCount() const;   // acquire() calls that found no free ball
+
+private:
+  Controller*                       _controller;
+  GMlib::PSurfVisualizer<float,3>*  _visualizer;
+  float                             _radius;
+  GMlib::Material                   _material;
+  int                               _samples;
+
+  std::vector<Ball*>                _free;
+  int                               _active {0};
+  long                              _misses {0};
+
+  Ball*                 make();
+
+}; // END class BallPool
+
+#endif // BALLPOOL_H
@@ -0,0 +1,683 @@
+#include "ballstore.h"
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+BallStore::BallStore(GMlib::PSurf<float,3>* surface)
+  : _surface{surface}, _traits{SurfaceTraits::detect(*surface)}, _projectionStats(1), _stepBatches(1) {
+
+  resetProjectionStats();
+}
+
+int BallStore::add(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, float radius, double mass) {
+
+  const int handle = reserveHandle();
+  if( handle >= 0 )
+    add(handle, pos, velocity, radius, mass);
+  return handle;
+}
+
+void BallStore::add(int handle, const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, float radius, double mass) {
+
+  _pos.push_back(pos);
+  _prevPos.push_back(pos);
+  _velocity.push_back(velocity);
+  _dS.push_back(GMlib::Vector<float,3>(0,0,0));
+  _radius.push_back(radius);
+  _mass.push_back(mass);
+  _x.push_back(0);
+  _generation.push_back(0);
+  _quietFrames.push_back(0);
+  _asleep.push_back(0);
+
+  const int number = getHandleNumber(handle);
+  if( number >= int(_slotOf.size()) )
+    _slotOf.resize(number + 1, -1);
+  _slotOf[number] = size() - 1;
+  _handleOf.push_back(handle);
+
+  float u, v;
+  findSeed(pos, u, v);
+
+  SurfaceSample sample;
+  if( _traits.isAnalytic() )
+    _projector.project(_traits, pos, u, v, sample);
+  else
+    _projector.project(*_surface, pos, u, v, sample);
+  _u.push_back(u);
+  _v.push_back(v);
+  _surfPoint.push_back(sample.point);
+  _normal.push_back(sample.normal);
+}
+
+void BallStore::findSeed(const GMlib::Point<float,3>& p, float& u, float& v) {
+
+  const int steps = 20;
+  if( _seeds.empty() ) {
+    const float u0 = _surface->getParStartU(), du = _surface->getParDeltaU();
+    const float v0 = _surface->getParStartV(), dv = _surface->getParDeltaV();
+    for( int i = 0; i <= steps; ++i )
+      for( int j = 0; j <= steps; ++j ) {
+        Seed seed;
+        seed.u = u0 + du * i / steps;
+        seed.v = v0 + dv * j / steps;
+        seed.point = _surface->evaluate(seed.u, seed.v, 0, 0)[0][0];
+        _seeds.push_back(seed);
+      }
+  }
+
+  float best = std::numeric_limits<float>::max();
+  for( const Seed& seed : _seeds ) {
+    const float d = (seed.point - p).getLength();
+    if( d < best ) {
+      best = d;
+      u = seed.u;
+      v = seed.v;
+    }
+  }
+}
+
+int BallStore::reserveHandle() {
+
+  std::lock_guard<std::mutex> lock(_handleMutex);
+  int handle = -1;
+  if( !_freeHandles.empty() ) {
+    handle = _freeHandles.back();
+    _freeHandles.pop_back();
+  }
+  else if( _handleCount < (1 << HandleBits) ) {
+    handle = _handleCount++;
+    _issued.push_back(-1);
+  }
+  else
+    return -1;   // a larger number would run into the generation bits
+
+  _issued[getHandleNumber(handle)] = handle;
+  return handle;
+}
+
+bool BallStore::retireHandle(int handle) {
+
+  std::lock_guard<std::mutex> lock(_handleMutex);
+  const int number = getHandleNumber(handle);
+  if( handle < 0 || number >= int(_issued.size()) || _issued[number] != handle )
+    return false;
+  _issued[number] = -1;
+  return true;
+}
+
+namespace {
+
+  template <typename T>
+  void swapRemove(std::vector<T>& v, int i) {
+
+    v[i] = v.back();
+    v.pop_back();
+  }
+
+}
+
+int BallStore::remove(int handle) {
+
+  if( !isValid(handle) )
+    return -1;
+
+  const int slot = getSlot(handle);
+  if( _asleep[slot] )
+    _sleeping--;
+
+  swapRemove(_pos, slot);
+  swapRemove(_prevPos, slot);
+  swapRemove(_velocity, slot);
+  swapRemove(_dS, slot);
+  swapRemove(_radius, slot);
+  swapRemove(_mass, slot);
+  swapRemove(_u, slot);
+  swapRemove(_v, slot);
+  swapRemove(_surfPoint, slot);
+  swapRemove(_normal, slot);
+  swapRemove(_x, slot);
+  swapRemove(_generation, slot);
+  swapRemove(_quietFrames, slot);
+  swapRemove(_asleep, slot);
+  swapRemove(_handleOf, slot);
+
+  _slotOf[getHandleNumber(handle)] = -1;
+  if( slot < size() )
+    _slotOf[getHandleNumber(_handleOf[slot])] = slot;
+
+  // the generation wraps within the bits above the number, the sign bit stays clear
+  const int generation = ((unsigned(handle) >> HandleBits) + 1) & ((1u << (31 - HandleBits)) - 1);
+  std::lock_guard<std::mutex> lock(_handleMutex);
+  _issued[getHandleNumber(handle)] = -1;
+  _freeHandles.push_back((generation << HandleBits) | getHandleNumber(handle));
+  return slot;
+}
+
+int BallStore::size() const {
+
+  return int(_pos.size());
+}
+
+int BallStore::getHandleNumber(int handle) {
+
+  return handle & ((1 << HandleBits) - 1);
+}
+
+int BallStore::getHandleCount() const {
+
+  return int(_slotOf.size());
+}
+
+bool BallStore::isValid(int handle) const {
+
+  if( handle < 0 )
+    return false;
+  const int number = getHandleNumber(handle);
+  return number < int(_slotOf.size()) && _slotOf[number] >= 0 && _handleOf[_slotOf[number]] == handle;
+}
+
+int BallStore::getSlot(int handle) const {
+
+  return _slotOf[getHandleNumber(handle)];
+}
+
+int BallStore::getHandle(int slot) const {
+
+  return _handleOf[slot];
+}
+
+namespace {
+
+  // spreads the low 16 bits of x to the even bits
+  unsigned int spreadBits(unsigned int x) {
+
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+  }
+
+  // v[k] = v[order[k]], following the cycles of the permutation so no copy of v is needed
+  template <typename T>
+  void permute(std::vector<T>& v, const std::vector<int>& order, std::vector<char>& placed) {
+
+    placed.assign(order.size(), 0);
+    for( size_t start = 0; start < order.size(); ++start ) {
+      if( placed[start] )
+        continue;
+
+      const T first = v[start];
+      int k = int(start);
+      while( true ) {
+        placed[k] = 1;
+        const int from = order[k];
+        if( from == int(start) ) {
+          v[k] = first;
+          break;
+        }
+        v[k] = v[from];
+        k = from;
+      }
+    }
+  }
+
+}
+
+void BallStore::reorder() {
+
+  const int n = size();
+  if( n < 2 )
+    return;
+
+  // the parameters are quantized over the range the balls cover
+  float u0 = _u[0], u1 = _u[0], v0 = _v[0], v1 = _v[0];
+  for( int i = 1; i < n; ++i ) {
+    u0 = std::min(u0, _u[i]);
+    u1 = std::max(u1, _u[i]);
+    v0 = std::min(v0, _v[i]);
+    v1 = std::max(v1, _v[i]);
+  }
+  const float su = u1 > u0 ? 65535.0f / (u1 - u0) : 0.0f;
+  const float sv = v1 > v0 ? 65535.0f / (v1 - v0) : 0.0f;
+
+  _mortonKeys.resize(n);
+  _newOrder.resize(n);
+  for( int i = 0; i < n; ++i ) {
+    const unsigned int qu = (unsigned int)((_u[i] - u0) * su);
+    const unsigned int qv = (unsigned int)((_v[i] - v0) * sv);
+    _mortonKeys[i] = spreadBits(qu) | (spreadBits(qv) << 1);
+    _newOrder[i] = i;
+  }
+  std::sort(_newOrder.begin(), _newOrder.end(), [this](int a, int b) {
+    return _mortonKeys[a] < _mortonKeys[b] || (_mortonKeys[a] == _mortonKeys[b] && a < b);
+  });
+
+  permute(_pos, _newOrder, _placed);
+  permute(_prevPos, _newOrder, _placed);
+  permute(_velocity, _newOrder, _placed);
+  permute(_dS, _newOrder, _placed);
+  permute(_radius, _newOrder, _placed);
+  permute(_mass, _newOrder, _placed);
+  permute(_u, _newOrder, _placed);
+  permute(_v, _newOrder, _placed);
+  permute(_surfPoint, _newOrder, _placed);
+  permute(_normal, _newOrder, _placed);
+  permute(_x, _newOrder, _placed);
+  permute(_generation, _newOrder, _placed);
+  permute(_quietFrames, _newOrder, _placed);
+  permute(_asleep, _newOrder, _placed);
+  permute(_handleOf, _newOrder, _placed);
+
+  for( int i = 0; i < n; ++i )
+    _slotOf[getHandleNumber(_handleOf[i])] = i;
+}
+
+const GMlib::Point<float,3>& BallStore::getPos(int i) const {
+
+  return _pos[i];
+}
+
+const GMlib::Point<float,3>& BallStore::getPrevPos(int i) const {
+
+  return _prevPos[i];
+}
+
+// position between the last two steps, alpha = 0 is before and alpha = 1 after the last step
+GMlib::Point<float,3> BallStore::getRenderPos(int i, double alpha) const {
+
+  return _prevPos[i] + alpha * (_pos[i] - _prevPos[i]);
+}
+
+void BallStore::translate(int i, const GMlib::Vector<float,3>& d) {
+
+  _pos[i] += d;
+}
+
+const GMlib::Vector<float,3>& BallStore::getVelocity(int i) const {
+
+  return _velocity[i];
+}
+
+void BallStore::setVelocity(int i, const GMlib::Vector<float,3>& velocity) {
+
+  _velocity[i] = velocity;
+  _generation[i]++;
+
+  // a weak push does not restart the count of an awake ball, so a ball brought to rest
+  // still falls asleep. A sleeping ball is not stepped, so any push has to wake it or
+  // the momentum it got would be lost
+  const float speed = velocity.getLength();
+  if( speed >= _sleepSpeed || (_asleep[i] && speed > 0.0f) )
+    wake(i);
+}
+
+const GMlib::Vector<float,3>& BallStore::getDs(int i) const {
+
+  return _dS[i];
+}
+
+float BallStore::getRadius(int i) const {
+
+  return _radius[i];
+}
+
+double BallStore::getMass(int i) const {
+
+  return _mass[i];
+}
+
+void BallStore::updateX(int i, double x) {
+
+  _x[i] = x;
+}
+
+double BallStore::getX(int i) const {
+
+  return _x[i];
+}
+
+// moves ball i along its path to frame time x, the path itself is unchanged so the
+// generation is kept and queued collisions of the ball stay valid
+void BallStore::advanceTo(int i, double x) {
+
+  if( x <= _x[i] )
+    return;
+
+  const double f = (x - _x[i]) / (1.0 - _x[i]);
+  _pos[i] += f * _dS[i];
+  _dS[i] *= 1.0 - f;
+  _x[i] = x;
+}
+
+GMlib::Point<float,3> BallStore::getPosAt(int i, double x) const {
+
+  return _pos[i] + (x - _x[i]) * getFrameDs(i);
+}
+
+GMlib::Vector<float,3> BallStore::getFrameDs(int i) const {
+
+  const double rest = 1.0 - _x[i];
+  if( rest < 1e-9 )
+    return GMlib::Vector<float,3>(0,0,0);
+  return (1.0 / rest) * _dS[i];
+}
+
+unsigned int BallStore::getGeneration(int i) const {
+
+  return _generation[i];
+}
+
+static_assert(sizeof(GMlib::Point<float,3>) == 3 * sizeof(float) && sizeof(GMlib::Vector<float,3>) == 3 * sizeof(float),
+              "points are read as plain float arrays");
+
+const float* BallStore::getPosArray() const {
+
+  return reinterpret_cast<const float*>(_pos.data());
+}
+
+const float* BallStore::getDsArray() const {
+
+  return reinterpret_cast<const float*>(_dS.data());
+}
+
+const float* BallStore::getRadiusArray() const {
+
+  return _radius.data();
+}
+
+const GMlib::Point<float,3>& BallStore::getSurfPoint(int i) const {
+
+  return _surfPoint[i];
+}
+
+// normal of the last projection, nothing is evaluated here
+const GMlib::Vector<float,3>& BallStore::getSurfNormal(int i) const {
+
+  return _normal[i];
+}
+
+void BallStore::setWorkerCount(int workers) {
+
+  _workerSurfaces.clear();
+  for( int w = 1; w < workers && !_traits.isAnalytic(); ++w ) {
+
+    // a Bezier floor is copied from its control net, without the scene object state
+    if( auto bezier = dynamic_cast<GMlib::PBezierSurf<float>*>(_surface) )
+      _workerSurfaces.emplace_back(new GMlib::PBezierSurf<float>(bezier->getControlPoints()));
+    else
+      _workerSurfaces.emplace_back(static_cast<GMlib::PSurf<float,3>*>(_surface->makeCopy()));
+  }
+
+  _projectionStats.resize(std::max(1, workers));
+  _stepBatches.resize(std::max(1, workers));
+  resetProjectionStats();
+}
+
+SurfaceProjector& BallStore::getProjector() {
+
+  return _projector;
+}
+
+bool BallStore::setFloorQuality(FloorQuality quality, int resolution) {
+
+  if( quality != FloorQuality::Exact &&
+      (!_heightField.isBuilt() || _heightField.getResolution() != resolution) &&
+      !_heightField.build(*_surface, resolution) ) {
+
+    _floorQuality = FloorQuality::Exact;
+    return false;
+  }
+
+  _floorQuality = quality;
+  return true;
+}
+
+FloorQuality BallStore::getFloorQuality() const {
+
+  return _floorQuality;
+}
+
+const HeightField& BallStore::getHeightField() const {
+
+  return _heightField;
+}
+
+void BallStore::resetProjectionStats() {
+
+  for( ProjectionStats& stats : _projectionStats ) {
+    stats.projections = 0;
+    stats.iterations = 0;
+  }
+}
+
+long BallStore::getProjectionCount() const {
+
+  long count = 0;
+  for( const ProjectionStats& stats : _projectionStats )
+    count += stats.projections;
+  return count;
+}
+
+long BallStore::getProjectionIterationCount() const {
+
+  long count = 0;
+  for( const ProjectionStats& stats : _projectionStats )
+    count += stats.iterations;
+  return count;
+}
+
+// computeStep only touches ball i, so different balls may be stepped from
+// different worker threads at the same time
+namespace {
+  const GMlib::Vector<float,3> g(0,0,-9.8);
+}
+
+void BallStore::computeStep(int i, double dt, int worker) {
+
+  GMlib::PSurf<float,3>* surface = worker == 0 || _traits.isAnalytic() ? _surface : _workerSurfaces[worker-1].get();
+  const GMlib::Point<float,3> target = startStep(i, dt);
+
+  SurfaceSample sample;
+  if( _floorQuality != FloorQuality::Exact ) {
+    _heightField.project(target, sample);
+    _u[i] = sample.u;
+    _v[i] = sample.v;
+  }
+
+  // warm started from the parameters of the last step, or from the height field
+  if( _floorQuality != FloorQuality::HeightField ) {
+    ProjectionStats& stats = _projectionStats[worker];
+    stats.iterations += _traits.isAnalytic()
+        ? _projector.project(_traits, target, _u[i], _v[i], sample)
+        : _projector.project(*surface, target, _u[i], _v[i], sample);
+    stats.projections++;
+  }
+
+  finishStep(i, dt, sample);
+}
+
+void BallStore::computeSteps(const int* balls, int count, double dt, int worker) {
+
+  if( !_traits.isAnalytic() || _floorQuality == FloorQuality::HeightField ) {
+    for( int k = 0; k < count; ++k )
+      computeStep(balls[k], dt, worker);
+    return;
+  }
+
+  StepBatch& batch = _stepBatches[worker];
+  batch.target.resize(count);
+  batch.u.resize(count);
+  batch.v.resize(count);
+  batch.samples.resize(count);
+
+  for( int k = 0; k < count; ++k ) {
+    const int i = balls[k];
+    batch.target[k] = startStep(i, dt);
+    if( _floorQuality == FloorQuality::Refined ) {
+      SurfaceSample sample;
+      _heightField.project(batch.target[k], sample);
+      _u[i] = sample.u;
+      _v[i] = sample.v;
+    }
+    batch.u[k] = _u[i];
+    batch.v[k] = _v[i];
+  }
+
+  ProjectionStats& stats = _projectionStats[worker];
+  stats.iterations += _projector.project(_traits, count, batch.target.data(), batch.u.data(), batch.v.data(),
+                                         batch.samples.data(), batch.projection);
+  stats.projections += count;
+
+  for( int k = 0; k < count; ++k ) {
+    const int i = balls[k];
+    _u[i] = batch.u[k];
+    _v[i] = batch.v[k];
+    finishStep(i, dt, batch.samples[k]);
+  }
+}
+
+// new dS of ball i before it is put on the floor, returns the point to project
+GMlib::Point<float,3> BallStore::startStep(int i, double dt) {
+
+  _generation[i]++;
+  _dS[i] = dt * _velocity[i] + 0.5 * dt * dt * g;
+  return _pos[i] + _dS[i];
+}
+
+void BallStore::finishStep(int i, double dt, const SurfaceSample& sample) {
+
+  GMlib::Vector<float,3>& velocity = _velocity[i];
+  GMlib::Vector<float,3>& dS = _dS[i];
+
+  const GMlib::Vector<float,3>& norm = sample.normal;
+  _surfPoint[i] = sample.point;
+  _normal[i] = norm;
+
+  dS = sample.point + (_radius[i] * norm) - _pos[i];
+
+  double checkV1 = velocity * velocity + 2.0 * (g * dS);
+
+  velocity += dt * g;
+  velocity -= (velocity * norm) * norm;
+
+  double checkV2 = velocity * velocity;
+
+  if( checkV2 > 0.0001 && checkV1 > 0.0001 )
+    velocity *= std::sqrt(checkV1 / checkV2); // vector correction 1
+}
+
+void BallStore::setSleepThresholds(float speed, float distance, int frames) {
+
+  _sleepSpeed = speed;
+  _sleepDistance = distance;
+  _sleepFrames = frames;
+  if( frames <= 0 ) {
+    for( int i = 0; i < size(); ++i )
+      wake(i);
+    _sleeping = 0;
+  }
+}
+
+bool BallStore::isAsleep(int i) const {
+
+  return _asleep[i] != 0;
+}
+
+void BallStore::wake(int i) {
+
+  _quietFrames[i] = 0;
+  _asleep[i] = 0;
+}
+
+int BallStore::getSleepingCount() const {
+
+  return _sleeping;
+}
+
+const std::vector<int>& BallStore::getAwake() const {
+
+  return _awake;
+}
+
+void BallStore::beginStep() {
+
+  _prevPos.assign(_pos.begin(), _pos.end());
+
+  _awake.clear();
+  for( int i = 0; i < size(); ++i )
+    if( !_asleep[i] )
+      _awake.push_back(i);
+}
+
+// moves every ball to the end of its step, called when the frame is done
+void BallStore::advance() {
+
+  _sleeping = 0;
+  for( int i = 0; i < size(); ++i ) {
+    _pos[i] += _dS[i];
+    _x[i] = 0;
+
+    if( _asleep[i] ) {
+      _sleeping++;
+      continue;
+    }
+    if( _sleepFrames <= 0 )
+      continue;
+
+    if( _velocity[i].getLength() < _sleepSpeed && _dS[i].getLength() < _sleepDistance ) {
+      if( ++_quietFrames[i] >= _sleepFrames ) {
+        _asleep[i] = 1;
+        _sleeping++;
+        _velocity[i] = GMlib::Vector<float,3>(0,0,0);
+        _dS[i] = GMlib::Vector<float,3>(0,0,0);
+        _generation[i]++;
+      }
+    }
+    else
+      _quietFrames[i] = 0;
+  }
+}
+
+void BallStore::save(const int* balls, int count, BallState* states) const {
+
+  for( int k = 0; k < count; ++k ) {
+    const int i = balls[k];
+    BallState& s = states[k];
+    s.pos         = _pos[i];
+    s.surfPoint   = _surfPoint[i];
+    s.velocity    = _velocity[i];
+    s.dS          = _dS[i];
+    s.normal      = _normal[i];
+    s.u           = _u[i];
+    s.v           = _v[i];
+    s.x           = _x[i];
+    s.generation  = _generation[i];
+    s.quietFrames = _quietFrames[i];
+    s.asleep      = _asleep[i];
+  }
+}
+
+void BallStore::restore(const int* balls, int count, const BallState* states) {
+
+  for( int k = 0; k < count; ++k ) {
+    const int i = balls[k];
+    const BallState& s = states[k];
+    _pos[i]         = s.pos;
+    _surfPoint[i]   = s.surfPoint;
+    _velocity[i]    = s.velocity;
+    _dS[i]          = s.dS;
+    _normal[i]      = s.normal;
+    _u[i]           = s.u;
+    _v[i]           = s.v;
+    _x[i]           = s.x;
+    _generation[i]  = s.generation;
+    _quietFrames[i] = s.quietFrames;
+    _asleep[i]      = s.asleep;
+  }
+}
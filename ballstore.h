@@ -0,0 +1,202 @@
+#ifndef BALLSTORE_H
+#define BALLSTORE_H
+
+#include <parametrics/gmpsphere>
+#include <gmParametricsModule>
+
+#include "heightfield.h"
+#include "surfaceprojector.h"
+#include "surfacetraits.h"
+
+// stl
+#include <vector>
+#include <memory>
+#include <mutex>
+
+
+// How the balls find the floor below them: exact Newton search, sampled height
+// field only, or height field refined by the Newton search
+enum class FloorQuality { Exact, HeightField, Refined };
+
+// Physics state of all balls, one contiguous array per property.
+// The Controller simulates on this store, Ball scene objects only show it.
+// Balls are addressed by slot, their place in the arrays, which reorder() and
+// remove() change; the handle add() returns stays with the ball. A handle is a
+// number in the low bits and a generation above, the number of a removed ball is
+// given out again with the next generation, so old handles stay invalid.
+class BallStore {
+public:
+  explicit BallStore(GMlib::PSurf<float,3>* surface);
+
+  int                             add( const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity,
+                                       float radius, double mass );   // handle of the new ball, -1 if none is left
+  void                            add( int handle, const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity,
+                                       float radius, double mass );
+  int                             reserveHandle();   // for a later add(handle, ...), safe to call from any thread,
+                                                     // -1 when all 1 << HandleBits numbers are in use
+  bool                            retireHandle( int handle );   // false if already retired or removed, safe to call
+                                                                // from any thread, for a later remove(handle)
+  int                             remove( int handle );   // the slot the ball had, the last ball moves there, -1 if invalid
+  int                             size() const;
+
+  static const int                HandleBits = 20;
+  static int                      getHandleNumber( int handle );
+  int                             getHandleCount() const;   // handle numbers below this have been added
+  bool                            isValid( int handle ) const;
+  int                             getSlot( int handle ) const;
+  int                             getHandle( int slot ) const;
+
+  // sorts the balls along a Z-order (Morton) curve over their floor parameters,
+  // so balls near each other on the floor are near each other in memory
+  void                            reorder();
+
+  const GMlib::Point<float,3>&    getPos( int i ) const;
+  const GMlib::Point<float,3>&    getPrevPos( int i ) const;
+  GMlib::Point<float,3>           getRenderPos( int i, double alpha ) const;
+  void                            translate( int i, const GMlib::Vector<float,3>& d );
+
+  const GMlib::Vector<float,3>&   getVelocity( int i ) const;
+  void                            setVelocity( int i, const GMlib::Vector<float,3>& velocity );
+
+  const GMlib::Vector<float,3>&   getDs( int i ) const;
+  float                           getRadius( int i ) const;
+  double                          getMass( int i ) const;
+
+  // each ball keeps its own clock x in [0,1] of the frame: getPos() is where the ball
+  // is at x and getDs() what is left of its path until the end of the frame
+  void                            updateX( int i, double x );
+  double                          getX( int i ) const;
+  void                            advanceTo( int i, double x );
+  GMlib::Point<float,3>           getPosAt( int i, double x ) const;
+  GMlib::Vector<float,3>          getFrameDs( int i ) const;   // path speed per whole frame
+
+  unsigned int                    getGeneration( int i ) const;
+
+  // whole arrays for batched kernels, 3 floats per point
+  const float*                    getPosArray() const;
+  const float*                    getDsArray() const;
+  const float*                    getRadiusArray() const;
+
+  const GMlib::Point<float,3>&    getSurfPoint( int i ) const;
+  const GMlib::Vector<float,3>&   getSurfNormal( int i ) const;
+  void                            computeStep( int i, double dt, int worker = 0 );
+  // computeStep for count balls, on an analytic floor the projections are done in one batch
+  void                            computeSteps( const int* balls, int count, double dt, int worker = 0 );
+
+  void                            setWorkerCount( int workers );
+
+  SurfaceProjector&               getProjector();
+
+  // builds the height field when needed, false (and Exact kept) if the floor can not be sampled
+  bool                            setFloorQuality( FloorQuality quality, int resolution = 128 );
+  FloorQuality                    getFloorQuality() const;
+  const HeightField&              getHeightField() const;
+  void                            resetProjectionStats();
+  long                            getProjectionCount() const;
+  long                            getProjectionIterationCount() const;
+
+  // a ball whose speed and step stay below the thresholds for the given number of
+  // frames falls asleep, frames <= 0 turns sleeping off
+  void                            setSleepThresholds( float speed, float distance, int frames );
+  bool                            isAsleep( int i ) const;
+  void                            wake( int i );
+  int                             getSleepingCount() const;
+  const std::vector<int>&         getAwake() const;   // awake balls at the start of the step
+
+  void                            beginStep();
+  void                            advance();
+
+  // everything a step changes on one ball, to undo a part of a step
+  struct BallState {
+    GMlib::Point<float,3>                 pos, surfPoint;
+    GMlib::Vector<float,3>                velocity, dS, normal;
+    float                                 u, v;
+    double                                x;
+    unsigned int                          generation;
+    int                                   quietFrames;
+    char                                  asleep;
+  };
+  // state of balls[k] to and from states[k]
+  void                            save( const int* balls, int count, BallState* states ) const;
+  void                            restore( const int* balls, int count, const BallState* states );
+
+private:
+  GMlib::PSurf<float,3>*                _surface;
+  SurfaceTraits                         _traits;   // floors of a known type are projected without evaluate()
+
+  // evaluating a surface writes to it, so with a general floor each extra
+  // worker thread projects on its own copy
+  std::vector<std::unique_ptr<GMlib::PSurf<float,3>>>       _workerSurfaces;
+
+  SurfaceProjector                      _projector;
+  HeightField                           _heightField;
+  FloorQuality                          _floorQuality {FloorQuality::Exact};
+
+  // one counter block per worker, padded so workers do not share cache lines
+  struct ProjectionStats {
+    long                                projections;
+    long                                iterations;
+    char                                pad[64 - 2 * sizeof(long)];
+  };
+  std::vector<ProjectionStats>          _projectionStats;
+
+  // scratch of computeSteps, one per worker
+  struct StepBatch {
+    std::vector<GMlib::Point<float,3>>  target;
+    std::vector<float>                  u, v;
+    std::vector<SurfaceSample>          samples;
+    ProjectionBatch                     projection;
+  };
+  std::vector<StepBatch>                _stepBatches;
+
+  // coarse grid of floor points, the closest one starts the projection of a new
+  // ball so adding does not search the floor with estimateClpPar each time
+  struct Seed {
+    GMlib::Point<float,3>               point;
+    float                               u, v;
+  };
+  std::vector<Seed>                     _seeds;
+  void                                  findSeed( const GMlib::Point<float,3>& p, float& u, float& v );
+
+  GMlib::Point<float,3>                 startStep( int i, double dt );
+  void                                  finishStep( int i, double dt, const SurfaceSample& sample );
+
+  std::vector<GMlib::Point<float,3>>    _pos;
+  std::vector<GMlib::Point<float,3>>    _prevPos;  // position before the last step, for render interpolation
+  std::vector<GMlib::Vector<float,3>>   _velocity;
+  std::vector<GMlib::Vector<float,3>>   _dS;
+  std::vector<float>                    _radius;
+  std::vector<double>                   _mass;
+  std::vector<float>                    _u;
+  std::vector<float>                    _v;
+  std::vector<GMlib::Point<float,3>>    _surfPoint; // floor point below the ball, found by the last projection
+  std::vector<GMlib::Vector<float,3>>   _normal;    // floor normal at _surfPoint
+  std::vector<double>                   _x;         // local clock, frame time of _pos
+  std::vector<unsigned int>             _generation; // increased each time velocity or dS changes
+
+  // sleeping balls keep dS = 0 and are neither stepped nor tested against each other
+  float                                 _sleepSpeed {0.05f};
+  float                                 _sleepDistance {0.002f};
+  int                                   _sleepFrames {30};
+  std::vector<int>                      _quietFrames;
+  std::vector<char>                     _asleep;
+  std::vector<int>                      _awake;
+  int                                   _sleeping {0};      // counted in advance(), wake() may run on several threads
+
+  std::vector<int>                      _slotOf;     // by handle number, -1 after remove()
+  std::vector<int>                      _handleOf;   // by slot
+
+  // handles are given out and retired on any thread, so only these are shared
+  std::mutex                            _handleMutex;
+  int                                   _handleCount {0};
+  std::vector<int>                      _freeHandles;   // next generation of removed handles
+  std::vector<int>                      _issued;        // by handle number, the handle given out, -1 once retired
+
+  // scratch of reorder()
+  std::vector<unsigned int>             _mortonKeys;
+  std::vector<int>                      _newOrder;
+  std::vector<char>                     _placed;
+
+}; // END class BallStore
+
+#endif // BALLSTORE_H
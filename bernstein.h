@@ -0,0 +1,81 @@
+#ifndef BERNSTEIN_H
+#define BERNSTEIN_H
+
+#include <core/gmpoint>
+
+
+// Bernstein polynomials of a degree bounded at compile time. Everything lives on the
+// stack, and when the degree is the bound itself all loops have constant bounds so
+// the compiler can unroll them.
+namespace Bernstein {
+
+  // Basis of degree n <= N and its derivatives up to order K at one parameter value,
+  // d[k][i] is the k-th derivative of B_i^n. Only orders up to the one asked for are
+  // computed, orders above n are zero.
+  template <typename T, int N, int K = N>
+  struct Basis {
+    T     d[K + 1][N + 1];
+
+    void evaluate( T t, int order = K, int n = N ) {
+
+      if( n > N ) n = N;
+      if( order > K ) order = K;
+
+      // tri[m] is the basis of degree m, B_i^m = (1-t) B_i^(m-1) + t B_(i-1)^(m-1)
+      T tri[N + 1][N + 1];
+      tri[0][0] = T(1);
+      for( int m = 1; m <= n; ++m ) {
+        tri[m][0] = (T(1) - t) * tri[m - 1][0];
+        for( int i = 1; i < m; ++i )
+          tri[m][i] = (T(1) - t) * tri[m - 1][i] + t * tri[m - 1][i - 1];
+        tri[m][m] = t * tri[m - 1][m - 1];
+      }
+
+      // D^k B_i^n from the degree n-k basis, raising the degree once per derivative,
+      // D B_i^m = m (B_(i-1)^(m-1) - B_i^(m-1))
+      for( int k = 0; k <= order && k <= n; ++k ) {
+
+        T* row = d[k];
+        for( int i = 0; i <= n - k; ++i )
+          row[i] = tri[n - k][i];
+
+        for( int m = n - k + 1; m <= n; ++m ) {
+          row[m] = T(m) * row[m - 1];
+          for( int i = m - 1; i > 0; --i )
+            row[i] = T(m) * (row[i - 1] - row[i]);
+          row[0] = -T(m) * row[0];
+        }
+      }
+
+      for( int k = n + 1; k <= order; ++k )
+        for( int i = 0; i <= n; ++i )
+          d[k][i] = T(0);
+    }
+  };
+
+  // Tensor product patch of degree (NU,NV) with net[i][j] as control points.
+  // Fills p[a][b] = S_(u^a v^b) for a <= d1, b <= d2, p must already have that size,
+  // orders above the degree are zero.
+  template <typename T, int NU, int NV, typename Net, typename Result>
+  void evaluate( const Net& net, T u, T v, int d1, int d2, Result& p ) {
+
+    Basis<T,NU> bu;
+    Basis<T,NV> bv;
+    bu.evaluate(u, d1);
+    bv.evaluate(v, d2);
+
+    for( int a = 0; a <= d1; ++a )
+      for( int b = 0; b <= d2; ++b ) {
+
+        GMlib::Vector<T,3> s(T(0));
+        if( a <= NU && b <= NV )
+          for( int i = 0; i <= NU; ++i )
+            for( int j = 0; j <= NV; ++j )
+              s += (bu.d[a][i] * bv.d[b][j]) * net[i][j];
+        p[a][b] = s;
+      }
+  }
+
+} // END namespace Bernstein
+
+#endif // BERNSTEIN_H
@@ -0,0 +1,35 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "aabb.h"
+
+// stl
+#include <vector>
+#include <utility>
+
+
+enum class BroadPhaseKind { SpatialHash, SweepAndPrune, VerletList };
+
+// Candidate pairs of overlapping boxes. build() takes the boxes of a frame,
+// update() changes one box during the frame (a ball got a new dS) and query()
+// has to see the changed box right away. reset() drops what build() keeps from
+// the last frame, for when the ids were given to other boxes. remove() follows
+// BallStore::remove() between frames: box id is gone and box last takes its id.
+// Boxes past the last build are new to the broad phase, the next build gets
+// them at the end.
+class BroadPhase {
+public:
+  virtual ~BroadPhase() {}
+
+  virtual void          build( const std::vector<Aabb>& boxes ) = 0;
+  virtual void          update( int id, const Aabb& box ) = 0;
+  virtual void          reset() {}
+  virtual void          remove( int /*id*/, int /*last*/ ) { reset(); }
+
+  // pairs (i,j) with i < j, each reported once
+  virtual void          findPairs( std::vector<std::pair<int,int>>& pairs ) const = 0;
+  virtual void          query( int id, std::vector<int>& result ) = 0;
+
+}; // END class BroadPhase
+
+#endif // BROADPHASE_H
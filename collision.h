@@ -2,31 +2,47 @@
 #define COLLISION_H
 
 #include "gmpwall.h"
-#include "ball.h"
+#include "ballstore.h"
+
+// stl
+#include <algorithm>
+#include <functional>
 
 
 class Collision {
 public:
     Collision(){}
 
-    Collision(Ball* ball1, Ball* ball2, double x)
+    //the balls are kept in the order of their handles, which do not change when the store is reordered
+    Collision(const BallStore& store, int ball1, int ball2, double x)
     {
+        if (store.getHandle(ball2) < store.getHandle(ball1)) std::swap(ball1, ball2);
         _balls[0] = ball1;
         _balls[1] = ball2;
+        _keys[0] = store.getHandle(ball1);
+        _keys[1] = store.getHandle(ball2);
+        _gens[0] = store.getGeneration(ball1);
+        _gens[1] = store.getGeneration(ball2);
+        this->_wall = nullptr;
         this->_x = x;
         _colBW = false;
 
     }
 
-    Collision(Ball* ball, PWall* wall, double x)
+    Collision(const BallStore& store, int ball, PWall* wall, double x)
     {
         _balls[0] = ball;
+        _balls[1] = -1;
+        _keys[0] = store.getHandle(ball);
+        _keys[1] = -1;
+        _gens[0] = store.getGeneration(ball);
+        _gens[1] = 0;
         this->_wall = wall;
         this->_x = x;
         _colBW = true;
     }
 
-    Ball* getBall(int i) const
+    int getBall(int i) const
     {
         return _balls[i];
     }
@@ -46,30 +62,48 @@ public:
         return _colBW;
     }
 
+    bool hasBall(int ball) const
+    {
+        return _balls[0] == ball || (!_colBW && _balls[1] == ball);
+    }
+
+    //the ball was moved to another slot of the store, its generation moved with it
+    void renameBall(int from, int to)
+    {
+        if (_balls[0] == from) _balls[0] = to;
+        if (!_colBW && _balls[1] == from) _balls[1] = to;
+    }
+
+    //false if a ball has changed its path since the collision was found
+    bool isValid(const BallStore& store) const
+    {
+        if (store.getGeneration(_balls[0]) != _gens[0]) return false;
+        if (!_colBW && store.getGeneration(_balls[1]) != _gens[1]) return false;
+        return true;
+    }
+
     void updateX(double x)
     {
       _x = x;
     }
 
     //operators
+    //ties are broken on the ball handles, so collisions are popped in the same order
+    //from one queue for all balls as from a queue per island, and wherever the balls are stored
     bool operator < (const  Collision& other)const
     {
-        return _x < other._x;
-    }
-
-    bool operator == (const  Collision& other)const
-    {
-        if (_balls[0] == other._balls[0]) return true;
-        if (!other._colBW && _balls[0] == other._balls[1]) return true;
-        if (!(_colBW) && _balls[1] == other._balls[0]) return true;
-        if (!(_colBW) && !(other._colBW) && _balls[1] == other._balls[1]) return true;
-        return false;
+        if (_x != other._x) return _x < other._x;
+        if (_keys[0] != other._keys[0]) return _keys[0] < other._keys[0];
+        if (_keys[1] != other._keys[1]) return _keys[1] < other._keys[1];
+        return std::less<const PWall*>()(_wall, other._wall);
     }
 
   ~Collision() {}
 
 private:
-    Ball* _balls[2];
+    int _balls[2];
+    int _keys[2]; //handles of the balls
+    unsigned int _gens[2];
     PWall* _wall;
     double _x;
     bool _colBW;
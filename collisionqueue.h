@@ -0,0 +1,75 @@
+#ifndef COLLISIONQUEUE_H
+#define COLLISIONQUEUE_H
+
+#include "collision.h"
+
+// stl
+#include <vector>
+#include <algorithm>
+
+
+// Binary min-heap of collisions keyed on Collision::getX().
+// Nothing is removed when a ball changes its path, instead the popped
+// collisions are checked against the generation counters of their balls.
+class CollisionQueue {
+public:
+    void push(const Collision& col)
+    {
+        _heap.push_back(col);
+        std::push_heap(_heap.begin(), _heap.end(), later);
+    }
+
+    Collision pop()
+    {
+        std::pop_heap(_heap.begin(), _heap.end(), later);
+        Collision col = _heap.back();
+        _heap.pop_back();
+        return col;
+    }
+
+    bool empty() const
+    {
+        return _heap.empty();
+    }
+
+    int getSize() const
+    {
+        return int(_heap.size());
+    }
+
+    void clear()
+    {
+        _heap.clear();
+    }
+
+    void reserve(int count)
+    {
+        _heap.reserve(count);
+    }
+
+    //drops the collisions of a removed ball, those of the ball moved into its slot follow it
+    void removeBall(int ball, int moved)
+    {
+        size_t kept = 0;
+        for (size_t k = 0; k < _heap.size(); k++)
+        {
+            if (_heap[k].hasBall(ball)) continue;
+            _heap[kept] = _heap[k];
+            _heap[kept].renameBall(moved, ball);
+            kept++;
+        }
+        _heap.resize(kept);
+        std::make_heap(_heap.begin(), _heap.end(), later);
+    }
+
+private:
+    std::vector<Collision> _heap;
+
+    static bool later(const Collision& a, const Collision& b)
+    {
+        return b < a;
+    }
+
+}; // END class CollisionQueue
+
+#endif // COLLISIONQUEUE_H
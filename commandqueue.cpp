@@ -0,0 +1,23 @@
+#include "commandqueue.h"
+
+
+void CommandQueue::post(Command command) {
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _pending.push_back(std::move(command));
+}
+
+void CommandQueue::apply(BallStore& store) {
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if( _pending.empty() )
+      return;
+    _pending.swap(_running);
+  }
+
+  // run outside the lock, so posting never waits for a command
+  for( Command& command : _running )
+    command(store);
+  _running.clear();
+}
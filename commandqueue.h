@@ -0,0 +1,28 @@
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+// stl
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class BallStore;
+
+
+// Changes to the ball state posted from the GUI thread. The Controller applies
+// them at the start of a step, on whichever thread runs the simulation.
+class CommandQueue {
+public:
+  typedef std::function<void(BallStore&)> Command;
+
+  void                  post( Command command );
+  void                  apply( BallStore& store );
+
+private:
+  std::mutex            _mutex;
+  std::vector<Command>  _pending;
+  std::vector<Command>  _running;
+
+}; // END class CommandQueue
+
+#endif // COMMANDQUEUE_H
@@ -1,36 +1,443 @@
 #include "controller.h"
 
-  Controller::Controller(GMlib::PBezierSurf<float>* surf)
+// stl
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+  Controller::Controller(GMlib::PSurf<float,3>* surf)
+      :_store(surf)
     {
-        this->toggleDefaultVisualizer();
-        this->replot(30,30,1,1);
+        //the controller sphere is never shown, and no visualizer keeps it usable without a GL context
         this->setVisible(false); //hiding controller sphere
 
         this->_surf = surf;
         this->insert(_surf);
 
+        _contexts.resize(1);
     }
 
     void Controller::insertBall(Ball* ball)
     {
+        int handle = addBall(ball->getPos(), ball->getVelocity(), ball->getRadius(), ball->getMass());
+        if (handle < 0) return; //no handle left, the ball stays out of the scene
+        ball->attach(handle, &_commands);
+
         this->insert(ball);
-        _arrBalls += ball;
+        const int number = BallStore::getHandleNumber(handle);
+        if (number >= int(_ballObjects.size())) _ballObjects.resize(number + 1, nullptr);
+        _ballObjects[number] = ball;
+    }
+
+    void Controller::removeBall(Ball* ball)
+    {
+        const int handle = ball->getIndex();
+        const int number = BallStore::getHandleNumber(handle);
+        if (handle < 0 || number >= int(_ballObjects.size()) || _ballObjects[number] != ball) return; //not one of ours
+
+        _ballObjects[number] = nullptr;
+        removeBall(handle);
+        ball->detach();
+        this->remove(ball);
+    }
+
+    int Controller::addBall(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, float radius, double mass)
+    {
+        const int handle = _store.reserveHandle();
+        if (handle < 0) return handle;
+        if (_simThread.joinable())
+        {
+            _commands.post([=](BallStore& store) { store.add(handle, pos, velocity, radius, mass); });
+        }
+        else
+        {
+            _store.add(handle, pos, velocity, radius, mass);
+        }
+        return handle;
+    }
+
+    bool Controller::removeBall(int handle)
+    {
+        if (_simThread.joinable())
+        {
+            //retired now, so a second remove of the same handle fails before the first one is applied
+            if (!_store.retireHandle(handle)) return false;
+            _commands.post([this, handle](BallStore&) { eraseBall(handle); });
+            return true;
+        }
+        return eraseBall(handle);
+    }
+
+    //on the thread that steps, whatever is kept by slot follows the last ball into the gap
+    bool Controller::eraseBall(int handle)
+    {
+        const int last = _store.size() - 1;
+        const int slot = _store.remove(handle);
+        if (slot < 0) return false;
+
+        //queues are empty between steps, but a removal must never leave a collision behind
+        for (size_t w = 0; w < _contexts.size(); w++)
+        {
+            _contexts[w].cols.removeBall(slot, last);
+        }
+        //the broad phases keep what they know, the last ball takes the slot as in the store
+        _spatialHash.remove(slot, last);
+        _sweepAndPrune.remove(slot, last);
+        _verletList.remove(slot, last);
+        _islandBroadPhase.remove(slot, last);
+        return true;
     }
 
     void Controller::insertWall(PWall* wall)
     {
         this->insert(wall);
         _arrWalls += wall;
+
+        _wallPlanes.push_back(wallPlane(_arrWalls.size()-1));
+        _wallBoxes.push_back(wallBox(_arrWalls.size()-1));
+        _wallTreeDirty = true;
+        _reservedBalls = 0; //the wall lists of the event buffers are sized by the wall count
+    }
+
+    void Controller::updateWalls()
+    {
+        for (int i = 0; i < _arrWalls.size(); i++)
+        {
+            _wallPlanes[i] = wallPlane(i);
+            _wallBoxes[i] = wallBox(i);
+        }
+        _wallTree.refit(_wallBoxes); //same walls, so the tree keeps its shape
+    }
+
+    Controller::WallPlane Controller::wallPlane(int wall)
+    {
+        PWall* w = _arrWalls[wall];
+        WallPlane plane;
+        plane.point = w->evaluate(w->getParStartU(), w->getParStartV(), 0, 0)[0][0];
+        plane.normal = w->getNormal();
+        return plane;
+    }
+
+    Aabb Controller::wallBox(int wall)
+    {
+        PWall* w = _arrWalls[wall];
+        const float u[2] = { w->getParStartU(), w->getParStartU() + w->getParDeltaU() };
+        const float v[2] = { w->getParStartV(), w->getParStartV() + w->getParDeltaV() };
+
+        Aabb box;
+        box.lo = box.hi = w->evaluate(u[0], v[0], 0, 0)[0][0];
+        for (int i = 0; i < 2; i++)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                const GMlib::Point<float,3> p = w->evaluate(u[i], v[j], 0, 0)[0][0];
+                for (int k = 0; k < 3; k++)
+                {
+                    box.lo[k] = std::min(box.lo(k), p(k));
+                    box.hi[k] = std::max(box.hi(k), p(k));
+                }
+            }
+        }
+
+        //walls fence the floor, a ball is stopped at any height like before
+        box.lo[2] = -std::numeric_limits<float>::max();
+        box.hi[2] = std::numeric_limits<float>::max();
+        return box;
+    }
+
+  Controller::~Controller()
+    {
+        stopSimulationThread();
+    }
+
+    BallStore& Controller::getStore()
+    {
+        return _store;
+    }
+
+    void Controller::setThreadCount(int threads)
+    {
+        _pool.setThreadCount(threads);
+        _store.setWorkerCount(_pool.getThreadCount());
+
+        _contexts.resize(_pool.getThreadCount());
+        for (size_t w = 0; w < _contexts.size(); w++)
+        {
+            _contexts[w].worker = int(w);
+        }
+        _reservedBalls = 0; //new contexts start empty
+    }
+
+    int Controller::getThreadCount() const
+    {
+        return _pool.getThreadCount();
+    }
+
+    void Controller::setParallelIslands(bool parallel)
+    {
+        _parallelIslands = parallel;
+    }
+
+    bool Controller::getParallelIslands() const
+    {
+        return _parallelIslands;
+    }
+
+    void Controller::setMaxIslandSize(int balls)
+    {
+        _maxIslandSize = std::max(1, balls);
+    }
+
+    int Controller::getIslandCount() const
+    {
+        return _islands; //islands with collisions resolved in parallel during the last frame
+    }
+
+    int Controller::getLargeIslandCount() const
+    {
+        return _largeIslands; //of those, islands too big for a member search, resolved one after another
+    }
+
+    int Controller::getIslandFallbackCount() const
+    {
+        return _islandFallbacks; //frames redone serially because islands came too close
+    }
+
+    int Controller::getCrowdedFrameCount() const
+    {
+        return _crowdedFrames; //frames left to the serial loop because one island held most balls
+    }
+
+    void Controller::setBroadPhase(BroadPhaseKind kind)
+    {
+        if (kind == BroadPhaseKind::SweepAndPrune) _broadPhase = &_sweepAndPrune;
+        else if (kind == BroadPhaseKind::VerletList) _broadPhase = &_verletList;
+        else _broadPhase = &_spatialHash;
+    }
+
+    BroadPhaseKind Controller::getBroadPhase() const
+    {
+        if (_broadPhase == &_sweepAndPrune) return BroadPhaseKind::SweepAndPrune;
+        if (_broadPhase == &_verletList) return BroadPhaseKind::VerletList;
+        return BroadPhaseKind::SpatialHash;
+    }
+
+    void Controller::setCellSize(float cell_size)
+    {
+        _spatialHash.setCellSize(cell_size);
+    }
+
+    float Controller::getCellSize() const
+    {
+        return _spatialHash.getCellSize();
+    }
+
+    void Controller::setVerletSkin(float skin)
+    {
+        _verletList.setSkin(skin);
+    }
+
+    float Controller::getVerletSkin() const
+    {
+        return _verletList.getSkin();
+    }
+
+    long Controller::getNeighbourListRebuildCount() const
+    {
+        return _verletList.getRebuildCount(); //frames the verlet lists were searched again, in total
+    }
+
+    double Controller::getAverageNeighbourCount() const
+    {
+        return _verletList.getAverageListLength();
+    }
+
+    int Controller::getCandidatePairCount() const
+    {
+        return _candidatePairs; //ball-ball pairs passed to findBBCol during the last frame
+    }
+
+    int Controller::getEventCount() const
+    {
+        return _events; //collisions handled during the last frame
+    }
+
+    int Controller::getStaleEventCount() const
+    {
+        return _staleEvents; //outdated collisions dropped during the last frame
+    }
+
+    int Controller::getWallTestCount() const
+    {
+        return _wallTests; //ball-wall pairs passed to findBWCol during the last frame
+    }
+
+    void Controller::setBatchedPairTests(bool batched)
+    {
+        _batchedPairTests = batched;
+    }
+
+    bool Controller::getBatchedPairTests() const
+    {
+        return _batchedPairTests;
+    }
+
+    ToiKernel& Controller::getToiKernel()
+    {
+        return _toiKernel;
+    }
+
+    int Controller::getExactPairTestCount() const
+    {
+        return _exactPairTests; //pairs of the broad phase passed to findBBCol during the last frame
+    }
+
+    void Controller::setProjectionTolerance(float tolerance)
+    {
+        _store.getProjector().setTolerance(tolerance);
+    }
+
+    void Controller::setMaxProjectionIterations(int iterations)
+    {
+        _store.getProjector().setMaxIterations(iterations);
+    }
+
+    bool Controller::setFloorQuality(FloorQuality quality, int resolution)
+    {
+        return _store.setFloorQuality(quality, resolution);
+    }
+
+    void Controller::setSleepThresholds(float speed, float distance, int frames)
+    {
+        _store.setSleepThresholds(speed, distance, frames);
+    }
+
+    int Controller::getSleepingCount() const
+    {
+        return _store.getSleepingCount(); //balls skipped by the last frame
+    }
+
+    void Controller::setReorderInterval(int frames)
+    {
+        _reorderInterval = std::max(0, frames);
+    }
+
+    int Controller::getReorderInterval() const
+    {
+        return _reorderInterval;
+    }
+
+    long Controller::getReorderCount() const
+    {
+        return _reorders;
+    }
+
+    double Controller::getAveragePairSpan() const
+    {
+        return _pairSpan; //slots between the two balls of a candidate pair in the last frame, small when neighbours are stored together
+    }
+
+    double Controller::getAverageProjectionIterations() const
+    {
+        //Newton steps per floor projection during the last frame
+        const long projections = _store.getProjectionCount();
+        return projections > 0 ? double(_store.getProjectionIterationCount())/projections : 0.0;
+    }
+
+    Aabb Controller::sweptBox(int ball) const
+    {
+        return Aabb::swept(_store.getPos(ball), _store.getDs(ball), _store.getRadius(ball));
+    }
+
+    void Controller::updateBox(EventContext& ctx, int ball)
+    {
+        const Aabb box = sweptBox(ball); //ball got new dS
+        if (ctx.island >= 0)
+        {
+            _islandBoxes[ball] = box;
+            _hulls[ball] = Aabb::merge(_hulls[ball], box);
+            _touched[ball] = 1;
+        }
+        if (!ctx.members) //the serial loop, or the one worker resolving the large islands
+        {
+            _broadPhase->update(ball, box);
+        }
+    }
+
+    void Controller::findNeighbours(EventContext& ctx, int ball)
+    {
+        updateBox(ctx, ball);
+
+        ctx.candidates.clear();
+        if (!ctx.members)
+        {
+            _broadPhase->query(ball, ctx.candidates);
+            if (ctx.island >= 0)
+            {
+                //balls of other islands are resolved by other workers, the broad phase still has their boxes
+                //from the start of the step. Meeting one is an escape, which the hulls show afterwards
+                ctx.candidates.erase(std::remove_if(ctx.candidates.begin(), ctx.candidates.end(),
+                                                    [this, &ctx](int j) { return _islandOf[j] != ctx.island; }),
+                                     ctx.candidates.end());
+            }
+            sortByHandle(ctx.candidates); //same order as within an island
+            return;
+        }
+
+        const Aabb& box = _islandBoxes[ball];
+        for (int k = 0; k < ctx.memberCount; k++)
+        {
+            const int j = ctx.members[k];
+            if (j != ball && box.overlaps(_islandBoxes[j]))
+            {
+                ctx.candidates.push_back(j);
+            }
+        }
+        sortByHandle(ctx.candidates);
+    }
+
+    //overlap corrections made while testing the candidates move balls for the next tests,
+    //in handle order they are made the same way wherever the balls are stored
+    void Controller::sortByHandle(std::vector<int>& balls) const
+    {
+        std::sort(balls.begin(), balls.end(), [this](int a, int b) { return _store.getHandle(a) < _store.getHandle(b); });
+    }
+
+    void Controller::findBBColNear(EventContext& ctx, int ball, int other, double prevX)
+    {
+        findNeighbours(ctx, ball);
+        for (size_t k = 0; k < ctx.candidates.size(); k++)
+        {
+            if (ctx.candidates[k] != other)
+            {
+                ctx.candidatePairs++;
+                findBBCol(ctx.candidates[k], ball, ctx.cols, prevX);
+            }
+        }
     }
 
-  Controller::~Controller() {}
+    void Controller::findBWColNear(EventContext& ctx, int ball, const PWall* skip, double prevX)
+    {
+        ctx.nearWalls.clear();
+        _wallTree.query(sweptBox(ball), ctx.nearWalls); //walls the ball can reach during the rest of the step
+        for (size_t k = 0; k < ctx.nearWalls.size(); k++)
+        {
+            if (_arrWalls[ctx.nearWalls[k]] != skip)
+            {
+                ctx.wallTests++;
+                findBWCol(ball, ctx.nearWalls[k], ctx.cols, prevX);
+            }
+        }
+    }
 
-    void Controller::findBBCol(Ball* ball1, Ball* ball2, GMlib::Array<Collision>& cols, double prevX)
+    void Controller::findBBCol(int ball1, int ball2, CollisionQueue& cols, double prevX)
     {
-        GMlib::Vector<float,3> divDs = ball1->getDs() - ball2->getDs(); //DS = k
-        //GMlib::Point<float,3> divPos = ball1->getCenterPos() - ball2->getCenterPos(); //q
-        GMlib::Point<float,3> divPos = ball1->getPos() - ball2->getPos(); //q
-        double sumRad = (ball1->getRadius()) + (ball2->getRadius()); //r
+        //the balls may have been moved to different times by earlier events,
+        //both are taken to the later one and their paths compared in frame time
+        const double startX = std::max(_store.getX(ball1), _store.getX(ball2));
+        GMlib::Vector<float,3> divDs = _store.getFrameDs(ball1) - _store.getFrameDs(ball2); //DS = k
+        GMlib::Point<float,3> divPos = _store.getPosAt(ball1, startX) - _store.getPosAt(ball2, startX); //q
+        double sumRad = (_store.getRadius(ball1)) + (_store.getRadius(ball2)); //r
 
         //a(x^2)+ bx + c = 0
         double a = divDs*divDs;
@@ -39,19 +446,14 @@
 
         double alterDskr =  b*b-4*a*c;
 
-        //check test
-      double check = (ball1->getPos() - ball2->getPos()).getLength() - sumRad;
-//      if (check >= 0.0 && check < 0.05)
-//      {
-//          qDebug() <<  check;
-//      }
-
-
-        if (c < 0) //check if balls get intersected // (c<0 && check < 0)
+        if (c < 0) //check if balls get intersected
         {
             double corrS = 0.51*(sumRad - divPos.getLength())/divPos.getLength();
-            ball1->translate(corrS*divPos);
-            ball2->translate(-corrS*divPos);
+            //a sleeping ball is static, the other one takes the whole correction
+            const bool asleep1 = _store.isAsleep(ball1);
+            const bool asleep2 = _store.isAsleep(ball2);
+            if (!asleep1) _store.translate(ball1, (asleep2 ? 2.0 : 1.0)*corrS*divPos);
+            if (!asleep2) _store.translate(ball2, -(asleep1 ? 2.0 : 1.0)*corrS*divPos);
 
             divPos *= 1+(2*corrS);
             b = (divPos*divDs);
@@ -60,72 +462,58 @@
 
         if (alterDskr > 0.0)
         {
-            double x = (-b - std::sqrt(alterDskr))/(2.0*a);
+            double x = startX + (-b - std::sqrt(alterDskr))/(2.0*a);
             if (prevX < x && x <= 1.0)
             {
-                cols.insertAlways(Collision(ball1,ball2,x));
-
-//                qDebug() << "ball1 v*v: " <<ball1->getVelocity() * ball1->getVelocity();
-//                qDebug() << "ball2 v*v: " <<ball2->getVelocity() * ball2->getVelocity();
-
-//                qDebug() << "";
-
-                //qDebug() << "Added to collision array with distance: " << check;
-
-                //cols+= Collision(ball1,ball2,x);
-                //qDebug() << (ball1->getPos() - ball2->getPos()).getLength();
-                //qDebug() << "x = " << x;
+                cols.push(Collision(_store,ball1,ball2,x));
             }
         }
-
     }
 
-    void Controller::findBWCol(Ball* ball, PWall* wall, GMlib::Array<Collision>& cols, double prevX)
+    void Controller::findBWCol(int ball, int wall, CollisionQueue& cols, double prevX)
     {
-        GMlib::Point<float,3> p = ball->getPos();
-        double r = ball->getRadius();
-        GMlib::Vector<float,3> n = wall->getNormal();
+        const double startX = _store.getX(ball);
+        GMlib::Point<float,3> p = _store.getPos(ball);
+        double r = _store.getRadius(ball);
+        const GMlib::Vector<float,3>& n = _wallPlanes[wall].normal;
 
-        wall->getClosestPoint(this->getPos(),_u,_v);
-        GMlib::DMatrix<GMlib::Vector<float,3>> sMatrix = wall->evaluate(_u,_v, 1,1);
-
-        GMlib::Vector<float,3> d = sMatrix[0][0] - p;
+        GMlib::Vector<float,3> d = _wallPlanes[wall].point - p; //any point of the plane gives the same distance
         double dn = d * n;
-        GMlib::Vector<float,3> dS = ball->getDs();
+        GMlib::Vector<float,3> dS = _store.getFrameDs(ball);
 
         if (dn + r > 0.0) //if ball and wall intersected
         {
-            ball->translate(2.0*(dn + r) * wall->getNormal());
+            _store.translate(ball, 2.0*(dn + r) * n);
             dn -= 2.0 * (dn + r);
         }
 
         if ((dS * n) < -0.00000001)
         {
-            double x = (r + dn)/(dS*n); //double x = (r-d*n)/(dS*n);
+            double x = startX + (r + dn)/(dS*n); //double x = (r-d*n)/(dS*n);
             if (prevX < x && x <= 1.0)
             {
-                cols.insertAlways(Collision(ball,wall,x));
+                cols.push(Collision(_store,ball,_arrWalls[wall],x));
                 //cols+=(Collision(ball,wall,x));
             }
         }
     }
 
-    void Controller::handleBBCol(Ball* ball1, Ball* ball2, double dt_part)
+    void Controller::handleBBCol(int ball1, int ball2, double dt_part, int worker)
     {
-        GMlib::Vector<float,3> vel_upd1 = ball1->getVelocity();
-        GMlib::Vector<float,3> vel_upd2 = ball2->getVelocity();
+        GMlib::Vector<float,3> vel_upd1 = _store.getVelocity(ball1);
+        GMlib::Vector<float,3> vel_upd2 = _store.getVelocity(ball2);
 
-        GMlib::UnitVector<float,3> d = ball2->getPos() - ball1->getPos();
+        GMlib::UnitVector<float,3> d = _store.getPos(ball2) - _store.getPos(ball1);
 
         double dd = d*d;
 
-        GMlib::Vector<float,3> v1 = ((ball1->getVelocity() * d)/dd)*d;
-        GMlib::Vector<float,3> v1n = ball1->getVelocity() - v1;
-        GMlib::Vector<float,3> v2 = ((ball2->getVelocity() * d)/dd)*d;
-        GMlib::Vector<float,3> v2n = ball2->getVelocity() - v2;
+        GMlib::Vector<float,3> v1 = ((_store.getVelocity(ball1) * d)/dd)*d;
+        GMlib::Vector<float,3> v1n = _store.getVelocity(ball1) - v1;
+        GMlib::Vector<float,3> v2 = ((_store.getVelocity(ball2) * d)/dd)*d;
+        GMlib::Vector<float,3> v2n = _store.getVelocity(ball2) - v2;
 
-        double mass1 = ball1->getMass();
-        double mass2 = ball2->getMass();
+        double mass1 = _store.getMass(ball1);
+        double mass2 = _store.getMass(ball2);
 
         GMlib::Vector<float,3> v11 = ((mass1-mass2)/(mass1+mass2))*v1+((2*mass2)/(mass1+mass2))*v2;
         GMlib::Vector<float,3> v22 = ((mass2-mass1)/(mass2+mass1))*v2+((2*mass1)/(mass2+mass1))*v1;
@@ -133,111 +521,574 @@
         vel_upd1 = v11 + v1n;
         vel_upd2 = v22 + v2n;
 
-        ball1->setVelocity(vel_upd1);
-        ball1->computeStep(dt_part);
+        _store.setVelocity(ball1, vel_upd1); //wakes a sleeping ball that was pushed
+        if (!_store.isAsleep(ball1)) _store.computeStep(ball1, dt_part, worker);
 
-        ball2->setVelocity(vel_upd2);
-        ball2->computeStep(dt_part);
+        _store.setVelocity(ball2, vel_upd2);
+        if (!_store.isAsleep(ball2)) _store.computeStep(ball2, dt_part, worker);
 
     }
 
-    void Controller::handleBWCol(Ball* ball, PWall* wall, double dt_part)
+    void Controller::handleBWCol(int ball, PWall* wall, double dt_part, int worker)
     {
-        GMlib::Vector<float,3> velocity_upd = ball->getVelocity();
+        GMlib::Vector<float,3> velocity_upd = _store.getVelocity(ball);
         GMlib::Vector<float,3> norm = wall->getNormal();
         velocity_upd -= (2.0*(velocity_upd*norm)) * norm; //reflection of velocity vector
 
-        if (ball->getVelocity().getLength() > 0.1) //check if the ball have non-zero(close to zero) velocity vector
+        if (_store.getVelocity(ball).getLength() > 0.1) //check if the ball have non-zero(close to zero) velocity vector
         {
-            ball->setVelocity(velocity_upd);
-            ball->computeStep(dt_part);
+            _store.setVelocity(ball, velocity_upd);
+            _store.computeStep(ball, dt_part, worker);
         }
         else
         {
-            ball->setVelocity(GMlib::Vector<float,3>(0,0,0));
+            _store.setVelocity(ball, GMlib::Vector<float,3>(0,0,0));
         }
     }
 
 
-    void Controller::localSimulate (double dt)
+    void Controller::setPhysicsRate(double hz)
+    {
+        if (hz > 0.0) _fixedDt = 1.0/hz;
+    }
+
+    double Controller::getPhysicsRate() const
+    {
+        return 1.0/_fixedDt;
+    }
+
+    void Controller::setMaxSubsteps(int steps)
+    {
+        _maxSubsteps = std::max(1, steps);
+    }
+
+    int Controller::getMaxSubsteps() const
+    {
+        return _maxSubsteps;
+    }
+
+    void Controller::startSimulationThread()
+    {
+        if (_simThread.joinable()) return;
+
+        _simQuit = false;
+        _pendingTime = 0.0;
+        _simClock = 0.0;
+        _renderClock = 0.0;
+        _simThread = std::thread(&Controller::simulationLoop, this);
+    }
+
+    void Controller::stopSimulationThread()
     {
-        for (int i=0; i<_arrBalls.size();i++)
+        if (!_simThread.joinable()) return;
+
         {
-            _arrBalls[i]->computeStep(dt); //compute step for all balls
+            std::lock_guard<std::mutex> lock(_simMutex);
+            _simQuit = true;
         }
+        _simWake.notify_one();
+        _simThread.join();
+    }
+
+    bool Controller::isSimulationThreadRunning() const
+    {
+        return _simThread.joinable();
+    }
 
-        for (int i=0; i<_arrBalls.size();i++)
+    void Controller::simulationLoop()
+    {
+        std::unique_lock<std::mutex> lock(_simMutex);
+        while (true)
         {
-            for (int j=i+1; j<_arrBalls.size();j++)
+            _simWake.wait(lock, [this] { return _simQuit || _pendingTime >= _fixedDt; });
+            if (_simQuit) return;
+
+            int steps = std::min(int(_pendingTime/_fixedDt), _maxSubsteps);
+            _pendingTime -= steps*_fixedDt;
+            if (_pendingTime >= _fixedDt) //too slow to keep up, drop the backlog instead of spiralling
+            {
+                _pendingTime = std::fmod(_pendingTime, _fixedDt);
+            }
+            lock.unlock();
+
+            for (int k = 0; k < steps; k++)
             {
-                findBBCol(_arrBalls[i],_arrBalls[j], _arrCols, 0); //find all ball-ball collisions
+                step(_fixedDt);
+                _simClock += _fixedDt;
             }
+            publishFrame();
+
+            lock.lock();
+        }
+    }
+
+    void Controller::publishFrame()
+    {
+        SimFrame& frame = _frames.getWriteBuffer();
+        const int n = _store.getHandleCount();
+        frame.prev.resize(n);
+        frame.pos.resize(n);
+        frame.normal.resize(n);
+        frame.velocity.resize(n);
+        frame.dS.resize(n);
+        frame.handle.assign(n, -1);
+        for (int i = 0; i < _store.size(); i++) //by handle, the slots change when the store is reordered
+        {
+            const int h = BallStore::getHandleNumber(_store.getHandle(i));
+            frame.handle[h] = _store.getHandle(i);
+            frame.prev[h] = _store.getPrevPos(i);
+            frame.pos[h] = _store.getPos(i);
+            frame.normal[h] = _store.getSurfNormal(i);
+            frame.velocity[h] = _store.getVelocity(i);
+            frame.dS[h] = _store.getDs(i);
+        }
+        frame.time = _simClock;
+        frame.dt = _fixedDt;
+
+        _frames.publish();
+    }
+
+    void Controller::showFrame()
+    {
+        _frames.update();
+        const SimFrame& frame = _frames.getReadBuffer();
+        if (frame.pos.empty()) return; //nothing published yet
+
+        //balls are shown two steps behind the posted time, one step for the interpolation
+        //and one for the simulation thread working on the newest step meanwhile
+        _renderClock = std::min(_renderClock, frame.time + 2.0*frame.dt);
+        const double alpha = std::max(0.0, (_renderClock - frame.time - frame.dt)/frame.dt);
+
+        for (int b = 0; b < int(_ballObjects.size()); b++)
+        {
+            Ball* ball = _ballObjects[b];
+            if (!ball || b >= int(frame.handle.size()) || frame.handle[b] != ball->getIndex()) continue; //not simulated yet
+            ball->showAt(frame.prev[b] + alpha*(frame.pos[b] - frame.prev[b]), frame.normal[b], frame.velocity[b], frame.dS[b]);
+        }
+    }
+
+    void Controller::localSimulate (double dt)
+    {
+        if (_simThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(_simMutex);
+                _pendingTime += dt;
+            }
+            _simWake.notify_one();
+
+            _renderClock += dt;
+            showFrame();
+            return;
+        }
+
+        //physics runs with fixed steps, the balls are shown in between the last two steps
+        _accumulator += dt;
+
+        int steps = 0;
+        while (_accumulator >= _fixedDt && steps < _maxSubsteps)
+        {
+            step(_fixedDt);
+            _accumulator -= _fixedDt;
+            steps++;
+        }
+
+        if (_accumulator >= _fixedDt) //too slow to keep up, drop the backlog instead of spiralling
+        {
+            _accumulator = std::fmod(_accumulator, _fixedDt);
+        }
+
+        const double alpha = _accumulator/_fixedDt;
+        for (size_t k = 0; k < _ballObjects.size(); k++)
+        {
+            Ball* ball = _ballObjects[k];
+            if (!ball) continue;
+            const int b = _store.getSlot(ball->getIndex());
+            ball->showAt(_store.getRenderPos(b, alpha), _store.getSurfNormal(b), _store.getVelocity(b), _store.getDs(b));
+        }
+    }
+
+    //the event buffers grow with the busiest frame, and each worker context with the biggest
+    //island it got so far. Sized by the ball count up front they do not grow during a frame
+    //long after warm-up, when balls come and go or another worker gets a big island
+    void Controller::reserveEventBuffers()
+    {
+        const int n = _store.size();
+        if (n <= _reservedBalls) return;
+
+        _reservedBalls = 2*n; //room to grow before reserving again
+        for (size_t w = 0; w < _contexts.size(); w++)
+        {
+            _contexts[w].cols.reserve(_eventsPerBall*_reservedBalls);
+            _contexts[w].candidates.reserve(_reservedBalls);
+            _contexts[w].nearWalls.reserve(_arrWalls.size());
+        }
+        _initialCols.reserve(_eventsPerBall*_reservedBalls);
+        _islandCols.reserve(_eventsPerBall*_reservedBalls);
+        _busyIslands.reserve(_reservedBalls);
+        _islandStart.reserve(_reservedBalls + 1); //at most one island per ball
+        _islandColStart.reserve(_reservedBalls + 1);
+    }
+
+    void Controller::step (double dt)
+    {
+        _commands.apply(_store); //input posted since the last step
+        reserveEventBuffers();
+        if (_reorderInterval > 0 && _frame > 0.0 && long(_frame) % _reorderInterval == 0)
+        {
+            reorderBalls();
+        }
+        _store.beginStep();
+        _store.resetProjectionStats();
+
+        const std::vector<int>& awake = _store.getAwake();
+        auto step = [this, dt, &awake](int worker, int begin, int end)
+        {
+            _store.computeSteps(awake.data() + begin, end - begin, dt, worker); //compute step for all awake balls, in one batch per worker
+        };
+        _pool.run(int(awake.size()), step);
+
+        _boxes.resize(_store.size());
+        for (int i=0; i<_store.size();i++)
+        {
+            _boxes[i] = sweptBox(i);
+        }
+        _broadPhase->build(_boxes);
+        _broadPhase->findPairs(_pairs);
+
+        for (size_t w = 0; w < _contexts.size(); w++)
+        {
+            EventContext& ctx = _contexts[w];
+            ctx.island = -1;
+            ctx.members = nullptr;
+            ctx.candidatePairs = ctx.events = ctx.staleEvents = ctx.wallTests = 0;
         }
+        EventContext& serial = _contexts[0];
+        serial.candidatePairs = _pairs.size();
 
-        for (int i=0; i<_arrBalls.size();i++)
+        _testKeys.clear();
+        _testFirst.clear();
+        _testSecond.clear();
+        //sized with the pair list, so they grow only when it does and not on every frame that tests a few more
+        _testKeys.reserve(_pairs.capacity());
+        _testFirst.reserve(_pairs.capacity());
+        _testSecond.reserve(_pairs.capacity());
+        _testFlags.reserve(_pairs.capacity());
+        long span = 0;
+        for (size_t k=0; k<_pairs.size();k++)
         {
-            for (int j=0; j<_arrWalls.size();j++)
+            const int ball1 = _pairs[k].first;
+            const int ball2 = _pairs[k].second;
+            span += ball2 - ball1;
+            if (_store.isAsleep(ball1) && _store.isAsleep(ball2))
             {
-                findBWCol(_arrBalls[i],_arrWalls[j], _arrCols, 0); //find all ball-wall collisions
+                serial.candidatePairs--; //two resting balls can not hit each other
+                continue;
             }
+            const unsigned long long handle1 = unsigned(_store.getHandle(ball1));
+            const unsigned long long handle2 = unsigned(_store.getHandle(ball2));
+            _testKeys.push_back(std::min(handle1, handle2) << 32 | std::max(handle1, handle2));
         }
 
-        while (_arrCols.getSize()>0)
+        //overlap corrections move balls for the tests after them, so the pairs are tested in the order
+        //of their handles: the results do not change with the broad phase order or when the store is reordered
+        std::sort(_testKeys.begin(), _testKeys.end());
+        for (size_t k=0; k<_testKeys.size();k++)
         {
-            _arrCols.sort();
-            _arrCols.makeUnique();
+            _testFirst.push_back(_store.getSlot(int(_testKeys[k] >> 32)));
+            _testSecond.push_back(_store.getSlot(int(_testKeys[k] & 0xffffffffu)));
+        }
+
+        _pairSpan = _pairs.empty() ? 0.0 : double(span)/_pairs.size();
+
+        const int tests = int(_testFirst.size());
+        _testFlags.resize(tests);
+        if (_batchedPairTests)
+        {
+            _toiKernel.classify(_store.getPosArray(), _store.getDsArray(), _store.getRadiusArray(),
+                                _testFirst.data(), _testSecond.data(), tests, 0.0f, 1.0f, _testFlags.data());
+        }
+        else
+        {
+            std::fill(_testFlags.begin(), _testFlags.end(), ToiKernel::Hit | ToiKernel::Overlap);
+        }
+
+        _moved.assign(_store.size(), 0);
+        _exactPairTests = 0;
+        for (int k=0; k<tests; k++)
+        {
+            const int ball1 = _testFirst[k];
+            const int ball2 = _testSecond[k];
+
+            //the batch saw the positions before any overlap correction of this loop
+            const bool moved = _moved[ball1] || _moved[ball2];
+            if (!_testFlags[k] && !moved) continue;
+            if ((_testFlags[k] & ToiKernel::Overlap) || moved) _moved[ball1] = _moved[ball2] = 1;
+
+            _exactPairTests++;
+            findBBCol(ball1, ball2, serial.cols, 0); //find all ball-ball collisions
+        }
+
+        if (_wallTreeDirty)
+        {
+            _wallTree.build(_wallBoxes);
+            _wallTreeDirty = false;
+        }
+
+        for (int i=0; i<_store.size();i++)
+        {
+            if (_store.isAsleep(i)) continue; //dS is 0, it can not reach a wall
+            findBWColNear(serial, i, nullptr, 0); //find all ball-wall collisions
+        }
+
+        _islands = _largeIslands = 0;
+        if (!_parallelIslands || _contexts.size() < 2 || !resolveIslands(dt))
+        {
+            resolveEvents(serial, dt);
+        }
+
+        _candidatePairs = _events = _staleEvents = _wallTests = 0;
+        for (size_t w = 0; w < _contexts.size(); w++)
+        {
+            _candidatePairs += _contexts[w].candidatePairs;
+            _events += _contexts[w].events;
+            _staleEvents += _contexts[w].staleEvents;
+            _wallTests += _contexts[w].wallTests;
+        }
+
+        _store.advance(); //move all balls to the end of this step
+        _frame += 1.0;
+    }
+
+    //sorts the store along the floor, the broad phases start over with the new slots
+    void Controller::reorderBalls()
+    {
+        _store.reorder();
+        resetBroadPhases();
+        _reorders++;
+    }
 
-            Collision col = _arrCols[0];
-            _arrCols.removeFront();
+    //the balls were renumbered, the broad phases lose their coherence and start over with the next build
+    void Controller::resetBroadPhases()
+    {
+        _spatialHash.reset();
+        _sweepAndPrune.reset();
+        _verletList.reset();
+        _islandBroadPhase.reset();
+    }
+
+    void Controller::resolveEvents(EventContext& ctx, double dt)
+    {
+        while (!ctx.cols.empty())
+        {
+            Collision col = ctx.cols.pop();
 
             //checks
+            if (!col.isValid(_store)) //one of the balls has been handled after this collision was found
+            {
+                ctx.staleEvents++;
+                continue;
+            }
+            ctx.events++;
 
             if (col.isColBW()) //if collision is between ball and wall
             {
-                handleBWCol(col.getBall(0),col.getWall(), (1-col.getX())*dt);
-                col.getBall(0)->updateX(col.getX());
+                _store.advanceTo(col.getBall(0), col.getX()); //the ball is at the wall
+                handleBWCol(col.getBall(0),col.getWall(), (1-col.getX())*dt, ctx.worker);
 
-                for (int i = 0; i < _arrBalls.size(); i++) //seek for further (for this dt) collisions
-                {
-                    if (_arrBalls[i] != col.getBall(0))
-                    {
-                        findBBCol(_arrBalls[i], col.getBall(0), _arrCols, col.getX());
-                    }
-                }
+                findBBColNear(ctx, col.getBall(0), -1, col.getX()); //seek for further (for this dt) collisions
 
-                for (int i = 0; i < _arrWalls.size(); i++)
-                {
-                    if (_arrWalls[i] != col.getWall())
-                    {
-                        findBWCol(col.getBall(0), _arrWalls[i], _arrCols, col.getX());
-                    }
-                }
+                findBWColNear(ctx, col.getBall(0), col.getWall(), col.getX());
             }
             else //if collision is between ball and ball
             {
-                col.getBall(0)->updateX(col.getX());
-                col.getBall(1)->updateX(col.getX());
+                _store.advanceTo(col.getBall(0), col.getX()); //both balls at the moment they touch
+                _store.advanceTo(col.getBall(1), col.getX());
 
-                handleBBCol(col.getBall(0), col.getBall(1), (1-col.getX())*dt);
+                handleBBCol(col.getBall(0), col.getBall(1), (1-col.getX())*dt, ctx.worker);
 
-                for (int i = 0; i < _arrBalls.size(); i++)
-                {
-                    if (_arrBalls[i] != col.getBall(0) && _arrBalls[i] != col.getBall(1))
-                    {
-                        findBBCol(_arrBalls[i], col.getBall(0), _arrCols, col.getX());
-                        findBBCol(_arrBalls[i], col.getBall(1), _arrCols, col.getX());
-                    }
-                }
+                updateBox(ctx, col.getBall(1));
+                findBBColNear(ctx, col.getBall(0), col.getBall(1), col.getX());
+                findBBColNear(ctx, col.getBall(1), col.getBall(0), col.getX());
+
+                findBWColNear(ctx, col.getBall(0), nullptr, col.getX());
+                findBWColNear(ctx, col.getBall(1), nullptr, col.getX());
+            }
+        }
+    }
+
+    int Controller::findIsland(int ball)
+    {
+        //union-find root with path halving
+        while (_islandOf[ball] != ball)
+        {
+            _islandOf[ball] = _islandOf[_islandOf[ball]];
+            ball = _islandOf[ball];
+        }
+        return ball;
+    }
+
+    bool Controller::resolveIslands(double dt)
+    {
+        EventContext& serial = _contexts[0];
+        const int n = _store.size();
+
+        //islands are connected components of boxes around all a ball can reach during the step,
+        //a collision turns a ball but seldom makes it much faster than the fastest ball of the frame.
+        //walls never move, so they do not join islands
+        _reachBoxes.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            const float reach = 2.0f * _store.getDs(i).getLength();
+            _reachBoxes[i] = Aabb::swept(_store.getPos(i), GMlib::Vector<float,3>(0,0,0), _store.getRadius(i) + reach);
+        }
+        _islandBroadPhase.build(_reachBoxes);
+        _islandBroadPhase.findPairs(_islandPairs);
+
+        _islandOf.resize(n);
+        for (int i = 0; i < n; i++) _islandOf[i] = i;
+        for (size_t k = 0; k < _islandPairs.size(); k++)
+        {
+            const int a = findIsland(_islandPairs[k].first);
+            const int b = findIsland(_islandPairs[k].second);
+            if (a != b) _islandOf[std::max(a, b)] = std::min(a, b);
+        }
+
+        //number the islands, a root is the lowest ball of its island
+        int islands = 0;
+        _islandFill.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            const int root = findIsland(i);
+            _islandFill[i] = root == i ? islands++ : _islandFill[root];
+        }
+        _islandOf.assign(_islandFill.begin(), _islandFill.end());
+
+        //balls sorted by island, ascending within each
+        _islandStart.assign(islands + 1, 0);
+        for (int i = 0; i < n; i++) _islandStart[_islandOf[i] + 1]++;
+        const int largest = *std::max_element(_islandStart.begin(), _islandStart.end());
+        if (largest > _maxIslandShare * n)
+        {
+            _crowdedFrames++; //nothing could run beside it
+            return false;
+        }
+        for (int k = 0; k < islands; k++) _islandStart[k + 1] += _islandStart[k];
+        _islandBalls.resize(n);
+        _islandFill.assign(_islandStart.begin(), _islandStart.end());
+        for (int i = 0; i < n; i++) _islandBalls[_islandFill[_islandOf[i]]++] = i;
 
-                for (int i = 0; i < _arrWalls.size(); i++)
+        //collisions found so far go to the island of their first ball
+        _initialCols.clear();
+        while (!serial.cols.empty()) _initialCols.push_back(serial.cols.pop());
+        _islandColStart.assign(islands + 1, 0);
+        for (size_t c = 0; c < _initialCols.size(); c++) _islandColStart[_islandOf[_initialCols[c].getBall(0)] + 1]++;
+        for (int k = 0; k < islands; k++) _islandColStart[k + 1] += _islandColStart[k];
+        _islandCols.resize(_initialCols.size());
+        _islandFill.assign(_islandColStart.begin(), _islandColStart.end());
+        for (size_t c = 0; c < _initialCols.size(); c++) _islandCols[_islandFill[_islandOf[_initialCols[c].getBall(0)]]++] = _initialCols[c];
+
+        _busyIslands.clear();
+        for (int k = 0; k < islands; k++)
+        {
+            if (_islandColStart[k + 1] > _islandColStart[k]) _busyIslands.push_back(k);
+        }
+        //largest first, the workers take the next island when they are done, so one big island
+        //does not leave the others waiting at the end
+        std::sort(_busyIslands.begin(), _busyIslands.end(), [this](int a, int b)
+        {
+            const int sizeA = _islandStart[a + 1] - _islandStart[a];
+            const int sizeB = _islandStart[b + 1] - _islandStart[b];
+            return sizeA > sizeB || (sizeA == sizeB && a < b);
+        });
+        _largeBusyIslands = 0;
+        while (_largeBusyIslands < int(_busyIslands.size()) &&
+               _islandStart[_busyIslands[_largeBusyIslands] + 1] - _islandStart[_busyIslands[_largeBusyIslands]] > _maxIslandSize)
+        {
+            _largeBusyIslands++;
+        }
+
+        _saved.resize(n);
+        _islandBoxes.assign(_boxes.begin(), _boxes.end());
+        _hulls.assign(_boxes.begin(), _boxes.end());
+        _touched.assign(n, 0);
+        const int serialPairs = serial.candidatePairs;
+        const int serialWallTests = serial.wallTests;
+
+        //the large islands share the broad phase, so the first job resolves all of them one after another
+        const int largeJobs = _largeBusyIslands > 0 ? 1 : 0;
+        auto resolve = [this, dt, largeJobs](int worker, int begin, int end)
+        {
+            EventContext& ctx = _contexts[worker];
+            for (int job = begin; job < end; job++)
+            {
+                const int first = job < largeJobs ? 0 : _largeBusyIslands + job - largeJobs;
+                const int last = job < largeJobs ? _largeBusyIslands : first + 1;
+                for (int k = first; k < last; k++)
                 {
-                    if (_arrWalls[i] != col.getWall())
+                    const int island = _busyIslands[k];
+                    const int* balls = &_islandBalls[_islandStart[island]];
+                    const int count = _islandStart[island + 1] - _islandStart[island];
+                    ctx.island = island;
+                    ctx.members = job < largeJobs ? nullptr : balls;
+                    ctx.memberCount = count;
+                    _store.save(balls, count, &_saved[_islandStart[island]]); //only its own balls can change
+                    for (int c = _islandColStart[island]; c < _islandColStart[island + 1]; c++)
                     {
-                        findBWCol(col.getBall(0), _arrWalls[i], _arrCols, col.getX());
-                        findBWCol(col.getBall(1), _arrWalls[i], _arrCols, col.getX());
+                        ctx.cols.push(_islandCols[c]);
                     }
+                    resolveEvents(ctx, dt);
                 }
             }
+            ctx.island = -1;
+            ctx.members = nullptr;
+        };
+        _pool.runDynamic(int(_busyIslands.size()) - _largeBusyIslands + largeJobs, 1, resolve);
 
+        //a ball turned faster than the reach may still have come near a ball of another island,
+        //the serial loop could then have found collisions between them. The hulls are swept
+        //apart from the broad phase, which stays as built for a serial redo
+        _islandBroadPhase.build(_hulls);
+        _islandBroadPhase.findPairs(_islandPairs);
+        bool escaped = false;
+        for (size_t k = 0; k < _islandPairs.size() && !escaped; k++)
+        {
+            const int a = _islandPairs[k].first;
+            const int b = _islandPairs[k].second;
+            if ((_touched[a] || _touched[b]) && _islandOf[a] != _islandOf[b]) escaped = true;
+        }
+
+        if (!escaped)
+        {
+            _islands = int(_busyIslands.size());
+            _largeIslands = _largeBusyIslands;
+            return true;
+        }
+
+        //undo the islands and let the serial loop redo the events
+        for (size_t k = 0; k < _busyIslands.size(); k++)
+        {
+            const int island = _busyIslands[k];
+            _store.restore(&_islandBalls[_islandStart[island]], _islandStart[island + 1] - _islandStart[island],
+                           &_saved[_islandStart[island]]);
+        }
+        for (int k = 0; k < _largeBusyIslands; k++) //their boxes went to the broad phase
+        {
+            const int island = _busyIslands[k];
+            for (int b = _islandStart[island]; b < _islandStart[island + 1]; b++)
+            {
+                const int ball = _islandBalls[b];
+                if (_touched[ball]) _broadPhase->update(ball, _boxes[ball]);
+            }
+        }
+        for (size_t w = 0; w < _contexts.size(); w++)
+        {
+            EventContext& ctx = _contexts[w];
+            ctx.candidatePairs = ctx.events = ctx.staleEvents = ctx.wallTests = 0;
         }
+        serial.candidatePairs = serialPairs;
+        serial.wallTests = serialWallTests;
+        for (size_t c = 0; c < _initialCols.size(); c++) serial.cols.push(_initialCols[c]);
+        _islandFallbacks++;
+        return false;
     }
@@ -2,27 +2,122 @@
 #define CONTROLLER_H
 
 #include <parametrics/gmpsphere>
+#include "aabbtree.h"
+#include "ball.h"
+#include "ballstore.h"
 #include "collision.h"
+#include "collisionqueue.h"
+#include "commandqueue.h"
+#include "spatialhash.h"
+#include "sweepandprune.h"
+#include "toikernel.h"
+#include "verletlist.h"
+#include "triplebuffer.h"
+#include "workerpool.h"
 //#include "surface type"
 
-#include <QDebug>
+// stl
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//ball state handed from the simulation thread to the renderer
+struct SimFrame {
+    std::vector<GMlib::Point<float,3>> prev; //before the last step
+    std::vector<GMlib::Point<float,3>> pos; //after the last step
+    std::vector<GMlib::Vector<float,3>> normal;
+    std::vector<GMlib::Vector<float,3>> velocity, dS; //after the last step, read by Ball's getters
+    std::vector<int> handle; //all by handle number, -1 for a number without ball
+    double time {0.0}; //simulated time at pos
+    double dt {0.0};
+};
 
 class Controller:public GMlib::PSphere<float> {
     GM_SCENEOBJECT(PSphere)
 
 public:
 
-  Controller(GMlib::PBezierSurf<float>* surf);
+  Controller(GMlib::PSurf<float,3>* surf);
   ~Controller();
 
-    void insertBall(Ball* ball);
+    //balls may come and go while the simulation thread runs, they join or leave the store with the next step
+    void insertBall(Ball* ball); //does nothing when no handle is left
+    void removeBall(Ball* ball); //the ball leaves the scene, the caller owns it again
+    int addBall(const GMlib::Point<float,3>& pos, const GMlib::Vector<float,3>& velocity, float radius, double mass); //handle, -1 if none is left
+    bool removeBall(int handle); //false if the handle is no longer valid or already removed
     void insertWall(PWall* wall);
+    void updateWalls(); //after walls have moved, refits the wall tree
+
+    void step(double dt); //one physics frame, also usable without a scene or GL context
+
+    void setPhysicsRate(double hz);
+    double getPhysicsRate() const;
+    void setMaxSubsteps(int steps);
+    int getMaxSubsteps() const;
+
+    //simulation on its own thread, balls, walls and settings must be set up before starting
+    void startSimulationThread();
+    void stopSimulationThread();
+    bool isSimulationThreadRunning() const;
+
+    void findBBCol(int ball1, int ball2, CollisionQueue& cols, double prevX);
+    void findBWCol(int ball, int wall, CollisionQueue& cols, double prevX);
+    void handleBBCol(int ball1, int ball2, double dt_part, int worker = 0);
+    void handleBWCol(int ball, PWall* wall, double dt_part, int worker = 0);
+
+    BallStore& getStore();
 
-    void findBBCol(Ball* ball1, Ball* ball2, GMlib::Array<Collision>& cols, double prevX);
-    void findBWCol(Ball* ball, PWall* wall, GMlib::Array<Collision>& cols, double prevX);
-    void handleBBCol(Ball* ball1, Ball* ball2, double dt_part);
-    void handleBWCol(Ball* ball, PWall* wall, double dt_part);
+    void setThreadCount(int threads);
+    int getThreadCount() const;
 
+    //with more than one thread, groups of balls that can not reach each other
+    //during a step resolve their collisions in parallel, with the serial result
+    void setParallelIslands(bool parallel);
+    bool getParallelIslands() const;
+    void setMaxIslandSize(int balls); //larger islands search neighbours in the broad phase, on one worker
+    int getIslandCount() const;
+    int getLargeIslandCount() const;
+    int getIslandFallbackCount() const;
+    int getCrowdedFrameCount() const;
+
+    void setBroadPhase(BroadPhaseKind kind);
+    BroadPhaseKind getBroadPhase() const;
+    void setCellSize(float cell_size); //spatial hash only
+    float getCellSize() const;
+    void setVerletSkin(float skin); //verlet lists only
+    float getVerletSkin() const;
+    long getNeighbourListRebuildCount() const;
+    double getAverageNeighbourCount() const;
+    int getCandidatePairCount() const;
+    int getEventCount() const;
+    int getStaleEventCount() const;
+    int getWallTestCount() const;
+
+    //the pairs of the broad phase are first tested in batches with SIMD, only those
+    //that may hit or overlap are solved by findBBCol, with the same events as without
+    void setBatchedPairTests(bool batched);
+    bool getBatchedPairTests() const;
+    ToiKernel& getToiKernel();
+    int getExactPairTestCount() const;
+
+    void setProjectionTolerance(float tolerance);
+    void setMaxProjectionIterations(int iterations);
+    double getAverageProjectionIterations() const;
+    bool setFloorQuality(FloorQuality quality, int resolution = 128);
+
+    //resting balls fall asleep and are skipped until a collision or input wakes them
+    void setSleepThresholds(float speed, float distance, int frames);
+    int getSleepingCount() const;
+
+    //every this many frames the store is sorted so balls near each other on the floor
+    //are near each other in memory, 0 keeps the order, Ball handles stay valid.
+    //Events and pair tests are ordered by handle, so the results do not change with it.
+    //Off by default: the demo scenes are not faster with it
+    void setReorderInterval(int frames);
+    int getReorderInterval() const;
+    long getReorderCount() const;
+    double getAveragePairSpan() const;
 
 protected:
 
@@ -30,10 +125,129 @@ protected:
 
 private:
 
-    GMlib::Array<Collision> _arrCols;
-    GMlib::Array<Ball*> _arrBalls;
+    BallStore _store;
+    std::vector<Ball*> _ballObjects; //scene objects showing the balls of _store, by handle number, GUI thread only
     GMlib::Array<PWall*> _arrWalls;
-    GMlib::PBezierSurf<float>* _surf;
+    GMlib::PSurf<float,3>* _surf;
+
+    //walls are planes, a point and the normal are all findBWCol needs
+    struct WallPlane {
+        GMlib::Point<float,3> point;
+        GMlib::Vector<float,3> normal;
+    };
+    std::vector<WallPlane> _wallPlanes;
+
+    //walls a swept ball can reach, the tree is built lazily after insertWall
+    std::vector<Aabb> _wallBoxes;
+    AabbTree _wallTree;
+    bool _wallTreeDirty {false};
+    int _wallTests {0};
+
+    WorkerPool _pool; //threads for the integration phase
+
+    //fixed time step clock
+    double _fixedDt {1.0/60.0};
+    int _maxSubsteps {4};
+    double _accumulator {0.0};
+
+    //simulation thread, the GUI thread posts frame time and input, and picks up finished frames
+    std::thread _simThread;
+    std::mutex _simMutex;
+    std::condition_variable _simWake;
+    double _pendingTime {0.0}; //guarded by _simMutex
+    bool _simQuit {false}; //guarded by _simMutex
+    double _simClock {0.0}; //simulation thread only
+    double _renderClock {0.0}; //GUI thread only
+    TripleBuffer<SimFrame> _frames;
+    CommandQueue _commands;
+
+    //broad phase, both kept so switching does not allocate
+    SpatialHash _spatialHash;
+    SweepAndPrune _sweepAndPrune;
+    VerletList _verletList;
+    BroadPhase* _broadPhase {&_spatialHash};
+    std::vector<Aabb> _boxes;
+    std::vector<std::pair<int,int>> _pairs;
+    int _candidatePairs {0};
+    int _events {0};
+    int _staleEvents {0};
+
+    double _frame {0.0}; //frames simulated
+
+    int _reorderInterval {0};
+    long _reorders {0};
+    double _pairSpan {0.0};
+
+    ToiKernel _toiKernel;
+    bool _batchedPairTests {true};
+    std::vector<unsigned long long> _testKeys; //handles of the pairs, sorted so the tests do not depend on the slots
+    std::vector<int> _testFirst; //pairs of the broad phase left to test, not both asleep
+    std::vector<int> _testSecond;
+    std::vector<unsigned char> _testFlags;
+    std::vector<char> _moved; //balls an overlap correction may have moved during the tests
+    int _exactPairTests {0};
+
+    //state of one event loop, the serial loop and each worker resolving islands have their own
+    struct EventContext {
+        CollisionQueue cols;
+        std::vector<int> candidates;
+        std::vector<int> nearWalls;
+        int island {-1}; //island being resolved, -1 for the serial loop
+        const int* members {nullptr}; //sorted balls of the island being resolved, nullptr: ask the broad phase
+        int memberCount {0};
+        int worker {0};
+        int candidatePairs {0};
+        int events {0};
+        int staleEvents {0};
+        int wallTests {0};
+    };
+    std::vector<EventContext> _contexts; //one per worker, the serial loop uses the first
+    int _reservedBalls {0}; //ball count the event buffers are sized for
+    int _eventsPerBall {4}; //queued collisions per ball the buffers make room for
+
+    //islands, groups of balls that can not reach each other during a step
+    bool _parallelIslands {true};
+    int _maxIslandSize {512}; //neighbours are searched among all members, bigger islands ask the broad phase
+    float _maxIslandShare {0.5f}; //of all balls, an island holding more would take as long as the serial loop
+    SweepAndPrune _islandBroadPhase;
+    std::vector<Aabb> _reachBoxes;
+    std::vector<std::pair<int,int>> _islandPairs;
+    std::vector<int> _islandOf; //union-find parent, then island number
+    std::vector<int> _islandFill;
+    std::vector<int> _islandStart;
+    std::vector<int> _islandBalls;
+    std::vector<int> _busyIslands; //largest first
+    int _largeBusyIslands {0}; //the first ones, bigger than _maxIslandSize
+    std::vector<Collision> _initialCols;
+    std::vector<int> _islandColStart;
+    std::vector<Collision> _islandCols;
+    std::vector<Aabb> _islandBoxes; //boxes as the serial loop would see them in the broad phase
+    std::vector<Aabb> _hulls; //every box a ball had during the step
+    std::vector<char> _touched;
+    std::vector<BallStore::BallState> _saved; //balls of the busy islands before resolving, placed like _islandBalls
+    int _islands {0};
+    int _largeIslands {0};
+    int _islandFallbacks {0};
+    int _crowdedFrames {0};
+
+    void reorderBalls();
+    bool eraseBall(int handle);
+    void resetBroadPhases();
+    Aabb sweptBox(int ball) const;
+    void updateBox(EventContext& ctx, int ball);
+    void findNeighbours(EventContext& ctx, int ball);
+    void sortByHandle(std::vector<int>& balls) const;
+    void findBBColNear(EventContext& ctx, int ball, int other, double prevX);
+    void findBWColNear(EventContext& ctx, int ball, const PWall* skip, double prevX);
+    void resolveEvents(EventContext& ctx, double dt);
+    void reserveEventBuffers();
+    bool resolveIslands(double dt);
+    int findIsland(int ball);
+    WallPlane wallPlane(int wall);
+    Aabb wallBox(int wall);
+    void simulationLoop();
+    void publishFrame();
+    void showFrame();
 
 }; // END class controller
 
@@ -0,0 +1,27 @@
+#include "demoscene.h"
+
+
+GMlib::PBezierSurf<float>* createDemoFloor() {
+
+  //curved Bezier surface based on matrix 11*11, a regular grid in x,y
+  GMlib::DMatrix<GMlib::Vector<float,3>> m(11,11);
+  for( int i = 0; i < 11; ++i )
+    for( int j = 0; j < 11; ++j )
+      m[i][j] = GMlib::Vector<float,3> (-10 + 2*j, -10 + 2*i, 0);
+
+  m[5][3] = GMlib::Vector<float,3> (-4,0,-70); //-70
+  m[5][7] = GMlib::Vector<float,3> (4,0,40); //40
+
+  return new GMlib::PBezierSurf<float>(m);
+}
+
+std::vector<PWall*> createDemoWalls() {
+
+  //simplewalls with getnormal, order: N, S, E, W
+  std::vector<PWall*> walls;
+  walls.push_back(new PWall(GMlib::Point<float,3>(10,10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(-20,0,0)));
+  walls.push_back(new PWall(GMlib::Point<float,3>(-10,-10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(20,0,0)));
+  walls.push_back(new PWall(GMlib::Point<float,3>(-10,10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(0,-20,0)));
+  walls.push_back(new PWall(GMlib::Point<float,3>(10,-10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(0,20,0)));
+  return walls;
+}
@@ -0,0 +1,16 @@
+#ifndef DEMOSCENE_H
+#define DEMOSCENE_H
+
+#include "gmpwall.h"
+
+#include <gmParametricsModule>
+
+// stl
+#include <vector>
+
+// The arena of the demo: a 20x20 Bezier floor with a pit and a bump, boxed in by four walls.
+// Shared by the GUI scene and the headless driver, neither creates visualizers here.
+GMlib::PBezierSurf<float>*  createDemoFloor();
+std::vector<PWall*>         createDemoWalls();
+
+#endif // DEMOSCENE_H
@@ -27,8 +27,13 @@ namespace Private {
 
 //    qDebug() << "Renderer::paint; " << _name.c_str();
 
-    const GMlib::TextureRenderTarget &render_tex = GMlibWrapper::getInstance().getRenderTextureOf(_name);
-    const GMlib::GL::Texture& tex = render_tex.getTexture();
+    // the render/camera pair is made a frame after the view is shown, and the
+    // copy keeps it alive if the view is hidden while this frame is drawn
+    const std::shared_ptr<const GMlib::TextureRenderTarget> render_tex = GMlibWrapper::getInstance().getRenderTextureOf(_name);
+    if( !render_tex )
+      return;
+
+    const GMlib::GL::Texture& tex = render_tex->getTexture();
 
     if( !_prog.isValid() ) {
 //      std::cout << "Prog ! valid: setting up." << std::endl;
@@ -147,7 +152,7 @@ namespace Private {
 
 
 
-GLSceneRenderer::GLSceneRenderer() : _renderer{nullptr}, _glsurface{nullptr}, _name{}, _paused{false} {
+GLSceneRenderer::GLSceneRenderer() : _renderer{nullptr}, _glsurface{nullptr}, _name{}, _paused{false}, _shown_name{} {
 
   _renderer.reset();
   setAcceptedMouseButtons(Qt::AllButtons);
@@ -158,6 +163,9 @@ GLSceneRenderer::GLSceneRenderer() : _renderer{nullptr}, _glsurface{nullptr}, _n
 
 GLSceneRenderer::~GLSceneRenderer() {
 
+  if(_shown_name.length() > 0)
+    emit signViewVisibilityChanged(_shown_name,false);
+
   _glsurface->makeCurrent(); {
     if(_renderer)
       _renderer.reset();
@@ -180,6 +188,8 @@ GLSceneRenderer::setTexName(const QString& name) {
 //    _renderer.reset(nullptr);
   else if(_renderer)
     _renderer->setName(_name.toStdString());
+
+  updateShown();
 }
 
 bool
@@ -191,6 +201,28 @@ GLSceneRenderer::isPaused() const {
 void GLSceneRenderer::setPaused(bool paused) {
 
   _paused = paused;
+
+  if(_shown_name.length() > 0)
+    emit signViewPausedChanged(_shown_name,_paused);
+}
+
+void
+GLSceneRenderer::updateShown() {
+
+  // tells the GMlibWrapper which render/camera pairs are on screen
+  const QString shown = isVisible() && window() ? _name : QString();
+  if(shown == _shown_name)
+    return;
+
+  if(_shown_name.length() > 0)
+    emit signViewVisibilityChanged(_shown_name,false);
+
+  _shown_name = shown;
+
+  if(_shown_name.length() > 0) {
+    emit signViewVisibilityChanged(_shown_name,true);
+    emit signViewPausedChanged(_shown_name,_paused);
+  }
 }
 
 void
@@ -207,6 +239,8 @@ GLSceneRenderer::sync() {
     connect( w, &Window::beforeRendering, _renderer.get(), &Private::Renderer::paint, Qt::DirectConnection );
   }
 
+  updateShown();
+
   if( !_renderer )
     return;
 
@@ -235,6 +269,8 @@ GLSceneRenderer::handleWindowChanged(QQuickWindow* window) {
   connect( w, &Window::sceneGraphInvalidated, this, &GLSceneRenderer::cleanup );
   connect( w, &Window::signFrameReady, this, &QQuickItem::update );
   connect( this, &GLSceneRenderer::signViewportChanged, w, &Window::signGuiViewportChanged );
+  connect( this, &GLSceneRenderer::signViewVisibilityChanged, w, &Window::signGuiViewVisibilityChanged );
+  connect( this, &GLSceneRenderer::signViewPausedChanged, w, &Window::signGuiViewPausedChanged );
   connect( this, &GLSceneRenderer::signMousePressed, w, &Window::signMousePressed );
   connect( this, &GLSceneRenderer::signMouseReleased, w, &Window::signMouseReleased);
   connect( this, &GLSceneRenderer::signMouseDoubleClicked, w, &Window::signMouseDoubleClicked);
@@ -250,6 +286,9 @@ void GLSceneRenderer::itemChange(ItemChange change, const ItemChangeData& value)
   if(change == QQuickItem::ItemVisibleHasChanged && !value.boolValue)
     _renderer = nullptr;
 
+  if(change == QQuickItem::ItemVisibleHasChanged)
+    updateShown();
+
   QQuickItem::itemChange(change,value);
 }
 
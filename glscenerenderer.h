@@ -84,9 +84,14 @@ private:
   std::shared_ptr<GLContextSurfaceWrapper>    _glsurface;
   QString                                     _name;
   bool                                        _paused;
+  QString                                     _shown_name;  // name last announced as visible
+
+  void                  updateShown();
 
 signals:
   void                  signViewportChanged( const QString& name, const QRectF& size );
+  void                  signViewVisibilityChanged( const QString& name, bool visible );
+  void                  signViewPausedChanged( const QString& name, bool paused );
   void                  signMousePressed( const QString& name, QMouseEvent* event );
   void                  signMouseReleased( const QString& name, QMouseEvent* event );
   void                  signMouseDoubleClicked( const QString& name, QMouseEvent* event );
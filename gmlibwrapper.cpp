@@ -7,8 +7,10 @@
 #include "gmpcurplane.h"
 #include "gmpwall.h"
 #include "ball.h"
+#include "ballpool.h"
 #include "collision.h"
 #include "controller.h"
+#include "demoscene.h"
 
 // GMlib
 #include <gmOpenglModule>
@@ -22,6 +24,8 @@
 #include <QDebug>
 
 // stl
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <thread>
 #include <mutex>
@@ -69,12 +73,13 @@ GMlibWrapper::~GMlibWrapper() {
 
     for( auto& rc_pair : _rc_pairs ) {
 
-      rc_pair.second.render->releaseCamera();
-      _scene->removeCamera( rc_pair.second.camera.get() );
-
-      rc_pair.second.render.reset();
-      rc_pair.second.camera.reset();
+      if( rc_pair.second.render )
+        releaseRenderCamPair(rc_pair.second);
     }
+    freeReleasedRenders(true);
+
+    _spawned.clear();
+    _ballPool.reset(); //free balls are not in the scene
 
     _scene->clear();
 
@@ -99,6 +104,93 @@ void GMlibWrapper::changeRenderGeometry(const QString& name, const QRectF& geome
   rc_pair.viewport.changed = true;
 }
 
+void GMlibWrapper::changeViewVisibility(const QString& name, bool visible) {
+
+  if( _rc_pairs.count(name.toStdString()) <= 0 )
+    return;
+
+  auto& rc_pair = _rc_pairs[name.toStdString()];
+  rc_pair.view.users = std::max( 0, rc_pair.view.users + (visible ? 1 : -1) );
+
+  // renderer and camera are made when the first view shows up and dropped with the last one
+  if( rc_pair.view.users > 0 && !rc_pair.render ) {
+
+    _glsurface->makeCurrent();
+    createRenderCamPair(rc_pair);
+    _glsurface->doneCurrent();
+  }
+  else if( rc_pair.view.users == 0 && rc_pair.render ) {
+
+    _glsurface->makeCurrent();
+    releaseRenderCamPair(rc_pair);
+    _glsurface->doneCurrent();
+  }
+}
+
+void GMlibWrapper::changeViewPaused(const QString& name, bool paused) {
+
+  if( _rc_pairs.count(name.toStdString()) <= 0 )
+    return;
+
+  _rc_pairs[name.toStdString()].view.paused = paused;
+}
+
+void GMlibWrapper::createRenderCamPair(RenderCamPair& rc_pair) {
+
+  auto render = std::make_shared<GMlib::DefaultRenderer>();
+  rc_pair.camera = std::make_shared<GMlib::Camera>();
+  render->setCamera(rc_pair.camera.get());
+  {
+    std::lock_guard<std::mutex> lock(_rc_mutex);
+    rc_pair.render = render;
+  }
+
+  if( rc_pair.setup )
+    rc_pair.setup(rc_pair);
+
+  // back where the user left it
+  if( rc_pair.saved_camera.valid )
+    rc_pair.camera->set( rc_pair.saved_camera.pos, rc_pair.saved_camera.dir, rc_pair.saved_camera.up );
+
+  _scene->insertCamera( rc_pair.camera.get() );
+  rc_pair.viewport.changed = true;
+}
+
+void GMlibWrapper::releaseRenderCamPair(RenderCamPair& rc_pair) {
+
+  rc_pair.saved_camera.valid = true;
+  rc_pair.saved_camera.pos   = rc_pair.camera->getPos();
+  rc_pair.saved_camera.dir   = rc_pair.camera->getDir();
+  rc_pair.saved_camera.up    = rc_pair.camera->getUp();
+
+  // the select renderer may still point at this camera from the last pick
+  if( _select_renderer )
+    _select_renderer->releaseCamera();
+
+  rc_pair.render->releaseCamera();
+  _scene->removeCamera( rc_pair.camera.get() );
+
+  // the render thread may still draw the last frame, the renderer is freed
+  // in freeReleasedRenders() once it has let go
+  {
+    std::lock_guard<std::mutex> lock(_rc_mutex);
+    _released_renders.push_back(rc_pair.render);
+    rc_pair.render.reset();
+  }
+  rc_pair.camera.reset();
+  rc_pair.view.render_ms = 0.0;
+}
+
+void GMlibWrapper::freeReleasedRenders(bool all) {
+
+  // no new copies are made of a released renderer, so a count of one stays one
+  std::lock_guard<std::mutex> lock(_rc_mutex);
+  _released_renders.erase(
+        std::remove_if( _released_renders.begin(), _released_renders.end(),
+                        [all]( const std::shared_ptr<GMlib::DefaultRenderer>& render ) { return all || render.use_count() == 1; } ),
+        _released_renders.end() );
+}
+
 void GMlibWrapper::timerEvent(QTimerEvent* e) {
 
   e->accept();
@@ -111,6 +203,8 @@ void GMlibWrapper::timerEvent(QTimerEvent* e) {
   // Grab and activate GL context
   _glsurface->makeCurrent(); {
 
+    freeReleasedRenders(false);
+
     // 1)
     _scene->prepare();
 
@@ -129,6 +223,12 @@ void GMlibWrapper::timerEvent(QTimerEvent* e) {
   //      qDebug() << "    Changed: " << rc_pair.second.viewport.changed;
   //      qDebug() << "    Geometry: " << rc_pair.second.viewport.geometry;
 
+      // only views on screen and not paused
+      if( !rc_pair.second.render || rc_pair.second.view.paused )
+        continue;
+
+      const auto render_start = std::chrono::steady_clock::now();
+
       if(rc_pair.second.viewport.changed) {
         const QSizeF size = rc_pair.second.viewport.geometry.size();
         rc_pair.second.render->reshape( GMlib::Vector<int,2>(size.width(),size.height()));
@@ -138,6 +238,9 @@ void GMlibWrapper::timerEvent(QTimerEvent* e) {
 
       rc_pair.second.render->render();
       rc_pair.second.render->swap();
+
+      rc_pair.second.view.render_ms =
+          std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - render_start).count();
     }
 
 //    for( auto& thread : threads )
@@ -199,43 +302,38 @@ void GMlibWrapper::initScene() {
     _rc_pairs["Side"]       = RenderCamPair {};
     _rc_pairs["Top"]        = RenderCamPair {};
 
-    for( auto& rcpair : _rc_pairs ) {
-
-      rcpair.second.render = std::make_shared<GMlib::DefaultRenderer>();
-      rcpair.second.camera = std::make_shared<GMlib::Camera>();
-      rcpair.second.render->setCamera(rcpair.second.camera.get());
-    }
+    // Cameras are set up when their view is first shown, see changeViewVisibility
 
     // Projection cam
-    auto& proj_rcpair = _rc_pairs["Projection"];
-    proj_rcpair.camera->set(init_cam_pos,init_cam_dir,init_cam_up);
-    proj_rcpair.camera->setCuttingPlanes( 1.0f, 8000.0f );
-    proj_rcpair.camera->rotateGlobal( GMlib::Angle(-45), GMlib::Vector<float,3>( 1.0f, 0.0f, 0.0f ) );
-    proj_rcpair.camera->translateGlobal( GMlib::Vector<float,3>( 0.0f, -30.0f, 30.0f ) );
-    _scene->insertCamera( proj_rcpair.camera.get() );
-    proj_rcpair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
-    proj_rcpair.render->setClearColor(GMlib::GMcolor::Black);
+    _rc_pairs["Projection"].setup = [=]( RenderCamPair& rc_pair ) {
+      rc_pair.camera->set(init_cam_pos,init_cam_dir,init_cam_up);
+      rc_pair.camera->setCuttingPlanes( 1.0f, 8000.0f );
+      rc_pair.camera->rotateGlobal( GMlib::Angle(-45), GMlib::Vector<float,3>( 1.0f, 0.0f, 0.0f ) );
+      rc_pair.camera->translateGlobal( GMlib::Vector<float,3>( 0.0f, -30.0f, 30.0f ) );
+      rc_pair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+      rc_pair.render->setClearColor(GMlib::GMcolor::Black);
+    };
 
     // Front cam
-    auto& front_rcpair = _rc_pairs["Front"];
-    front_rcpair.camera->set( init_cam_pos + GMlib::Vector<float,3>( 0.0f, -50.0f, 0.0f ), init_cam_dir, init_cam_up );
-    front_rcpair.camera->setCuttingPlanes( 1.0f, 8000.0f );
-    _scene->insertCamera( front_rcpair.camera.get() );
-    front_rcpair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+    _rc_pairs["Front"].setup = [=]( RenderCamPair& rc_pair ) {
+      rc_pair.camera->set( init_cam_pos + GMlib::Vector<float,3>( 0.0f, -50.0f, 0.0f ), init_cam_dir, init_cam_up );
+      rc_pair.camera->setCuttingPlanes( 1.0f, 8000.0f );
+      rc_pair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+    };
 
     // Side cam
-    auto& side_rcpair = _rc_pairs["Side"];
-    side_rcpair.camera->set( init_cam_pos + GMlib::Vector<float,3>( -50.0f, 0.0f, 0.0f ), GMlib::Vector<float,3>( 1.0f, 0.0f, 0.0f ), init_cam_up );
-    side_rcpair.camera->setCuttingPlanes( 1.0f, 8000.0f );
-    _scene->insertCamera( side_rcpair.camera.get() );
-    side_rcpair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+    _rc_pairs["Side"].setup = [=]( RenderCamPair& rc_pair ) {
+      rc_pair.camera->set( init_cam_pos + GMlib::Vector<float,3>( -50.0f, 0.0f, 0.0f ), GMlib::Vector<float,3>( 1.0f, 0.0f, 0.0f ), init_cam_up );
+      rc_pair.camera->setCuttingPlanes( 1.0f, 8000.0f );
+      rc_pair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+    };
 
     // Top cam
-    auto& top_rcpair = _rc_pairs["Top"];
-    top_rcpair.camera->set( init_cam_pos + GMlib::Vector<float,3>( 0.0f, 0.0f, 50.0f ), -init_cam_up, init_cam_dir );
-    top_rcpair.camera->setCuttingPlanes( 1.0f, 8000.0f );
-    _scene->insertCamera( top_rcpair.camera.get() );
-    top_rcpair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+    _rc_pairs["Top"].setup = [=]( RenderCamPair& rc_pair ) {
+      rc_pair.camera->set( init_cam_pos + GMlib::Vector<float,3>( 0.0f, 0.0f, 50.0f ), -init_cam_up, init_cam_dir );
+      rc_pair.camera->setCuttingPlanes( 1.0f, 8000.0f );
+      rc_pair.render->reshape( GMlib::Vector<int,2>(init_viewport_size, init_viewport_size) );
+    };
 
 
 
@@ -412,17 +510,7 @@ void GMlibWrapper::initScene() {
 
     //with collision controller-----------------------------------------------------------------------
     //simplewalls with getnormal
-           auto wallN = new PWall
-                   (GMlib::Point<float,3>(10,10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(-20,0,0));
-
-           auto wallS = new PWall
-                   (GMlib::Point<float,3>(-10,-10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(20,0,0));
-
-           auto wallW = new PWall
-                   (GMlib::Point<float,3>(10,-10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(0,20,0));
-
-           auto wallE = new PWall
-                   (GMlib::Point<float,3>(-10,10,0), GMlib::Vector<float,3>(0,0,2), GMlib::Vector<float,3>(0,-20,0));
+           std::vector<PWall*> walls = createDemoWalls(); //N, S, E, W
 
 //           auto wallN = new PWall<float>
 //                           (GMlib::Point<float,3>(-10,8,4), GMlib::Point<float,3>(-10,8,0),
@@ -447,143 +535,8 @@ void GMlibWrapper::initScene() {
 //           //floor->setMaterial(GMlib::GMmaterial::Jade);
 
            //---------------------curved test
-               //adding curved Bezier surface based on matrix 11*11
-
-               GMlib::DMatrix<GMlib::Vector<float,3>> m(11,11);
-
-               m[0][0] = GMlib::Vector<float,3> (-10,-10,0);
-               m[0][1] = GMlib::Vector<float,3> (-8,-10,0);
-               m[0][2] = GMlib::Vector<float,3> (-6,-10,0);
-               m[0][3] = GMlib::Vector<float,3> (-4,-10,0);
-               m[0][4] = GMlib::Vector<float,3> (-2,-10,0);
-               m[0][5] = GMlib::Vector<float,3> (0,-10,0);
-               m[0][6] = GMlib::Vector<float,3> (2,-10,0);
-               m[0][7] = GMlib::Vector<float,3> (4,-10,0);
-               m[0][8] = GMlib::Vector<float,3> (6,-10,0);
-               m[0][9] = GMlib::Vector<float,3> (8,-10,0);
-               m[0][10] = GMlib::Vector<float,3> (10,-10,0);
-
-               m[1][0] = GMlib::Vector<float,3> (-10,-8,0);
-               m[1][1] = GMlib::Vector<float,3> (-8,-8,0);
-               m[1][2] = GMlib::Vector<float,3> (-6,-8,0);
-               m[1][3] = GMlib::Vector<float,3> (-4,-8,0);
-               m[1][4] = GMlib::Vector<float,3> (-2,-8,0);
-               m[1][5] = GMlib::Vector<float,3> (0,-8,0);
-               m[1][6] = GMlib::Vector<float,3> (2,-8,0);
-               m[1][7] = GMlib::Vector<float,3> (4,-8,0);
-               m[1][8] = GMlib::Vector<float,3> (6,-8,0);
-               m[1][9] = GMlib::Vector<float,3> (8,-8,0);
-               m[1][10] = GMlib::Vector<float,3> (10,-8,0);
-
-               m[2][0] = GMlib::Vector<float,3> (-10,-6,0);
-               m[2][1] = GMlib::Vector<float,3> (-8,-6,0);
-               m[2][2] = GMlib::Vector<float,3> (-6,-6,0);
-               m[2][3] = GMlib::Vector<float,3> (-4,-6,0);
-               m[2][4] = GMlib::Vector<float,3> (-2,-6,0);
-               m[2][5] = GMlib::Vector<float,3> (0,-6,0);
-               m[2][6] = GMlib::Vector<float,3> (2,-6,0);
-               m[2][7] = GMlib::Vector<float,3> (4,-6,0);
-               m[2][8] = GMlib::Vector<float,3> (6,-6,0);
-               m[2][9] = GMlib::Vector<float,3> (8,-6,0);
-               m[2][10] = GMlib::Vector<float,3> (10,-6,0);
-
-               m[3][0] = GMlib::Vector<float,3> (-10,-4,0);
-               m[3][1] = GMlib::Vector<float,3> (-8,-4,0);
-               m[3][2] = GMlib::Vector<float,3> (-6,-4,0);
-               m[3][3] = GMlib::Vector<float,3> (-4,-4,0);
-               m[3][4] = GMlib::Vector<float,3> (-2,-4,0);
-               m[3][5] = GMlib::Vector<float,3> (0,-4,0);
-               m[3][6] = GMlib::Vector<float,3> (2,-4,0);
-               m[3][7] = GMlib::Vector<float,3> (4,-4,0);
-               m[3][8] = GMlib::Vector<float,3> (6,-4,0);
-               m[3][9] = GMlib::Vector<float,3> (8,-4,0);
-               m[3][10] = GMlib::Vector<float,3> (10,-4,0);
-
-               m[4][0] = GMlib::Vector<float,3> (-10,-2,0);
-               m[4][1] = GMlib::Vector<float,3> (-8,-2,0);
-               m[4][2] = GMlib::Vector<float,3> (-6,-2,0);
-               m[4][3] = GMlib::Vector<float,3> (-4,-2,0);
-               m[4][4] = GMlib::Vector<float,3> (-2,-2,0);
-               m[4][5] = GMlib::Vector<float,3> (0,-2,0);
-               m[4][6] = GMlib::Vector<float,3> (2,-2,0);
-               m[4][7] = GMlib::Vector<float,3> (4,-2,0);
-               m[4][8] = GMlib::Vector<float,3> (6,-2,0);
-               m[4][9] = GMlib::Vector<float,3> (8,-2,0);
-               m[4][10] = GMlib::Vector<float,3> (10,-2,0);
-
-               m[5][0] = GMlib::Vector<float,3> (-10,0,0);
-               m[5][1] = GMlib::Vector<float,3> (-8,0,0);
-               m[5][2] = GMlib::Vector<float,3> (-6,0,0);
-               m[5][3] = GMlib::Vector<float,3> (-4,0,-70); //-70
-               m[5][4] = GMlib::Vector<float,3> (-2,0,0);
-               m[5][5] = GMlib::Vector<float,3> (0,0,0);
-               m[5][6] = GMlib::Vector<float,3> (2,0,0);
-               m[5][7] = GMlib::Vector<float,3> (4,0,40); //40
-               m[5][8] = GMlib::Vector<float,3> (6,0,0);
-               m[5][9] = GMlib::Vector<float,3> (8,0,0);
-               m[5][10] = GMlib::Vector<float,3> (10,0,0);
-
-               m[6][0] = GMlib::Vector<float,3> (-10,2,0);
-               m[6][1] = GMlib::Vector<float,3> (-8,2,0);
-               m[6][2] = GMlib::Vector<float,3> (-6,2,0);
-               m[6][3] = GMlib::Vector<float,3> (-4,2,0);
-               m[6][4] = GMlib::Vector<float,3> (-2,2,0);
-               m[6][5] = GMlib::Vector<float,3> (0,2,0);
-               m[6][6] = GMlib::Vector<float,3> (2,2,0);
-               m[6][7] = GMlib::Vector<float,3> (4,2,0);
-               m[6][8] = GMlib::Vector<float,3> (6,2,0);
-               m[6][9] = GMlib::Vector<float,3> (8,2,0);
-               m[6][10] = GMlib::Vector<float,3> (10,2,0);
-
-               m[7][0] = GMlib::Vector<float,3> (-10,4,0);
-               m[7][1] = GMlib::Vector<float,3> (-8,4,0);
-               m[7][2] = GMlib::Vector<float,3> (-6,4,0);
-               m[7][3] = GMlib::Vector<float,3> (-4,4,0);
-               m[7][4] = GMlib::Vector<float,3> (-2,4,0);
-               m[7][5] = GMlib::Vector<float,3> (0,4,0);
-               m[7][6] = GMlib::Vector<float,3> (2,4,0);
-               m[7][7] = GMlib::Vector<float,3> (4,4,0);
-               m[7][8] = GMlib::Vector<float,3> (6,4,0);
-               m[7][9] = GMlib::Vector<float,3> (8,4,0);
-               m[7][10] = GMlib::Vector<float,3> (10,4,0);
-
-               m[8][0] = GMlib::Vector<float,3> (-10,6,0);
-               m[8][1] = GMlib::Vector<float,3> (-8,6,0);
-               m[8][2] = GMlib::Vector<float,3> (-6,6,0);
-               m[8][3] = GMlib::Vector<float,3> (-4,6,0);
-               m[8][4] = GMlib::Vector<float,3> (-2,6,0);
-               m[8][5] = GMlib::Vector<float,3> (0,6,0);
-               m[8][6] = GMlib::Vector<float,3> (2,6,0);
-               m[8][7] = GMlib::Vector<float,3> (4,6,0);
-               m[8][8] = GMlib::Vector<float,3> (6,6,0);
-               m[8][9] = GMlib::Vector<float,3> (8,6,0);
-               m[8][10] = GMlib::Vector<float,3> (10,6,0);
-
-               m[9][0] = GMlib::Vector<float,3> (-10,8,0);
-               m[9][1] = GMlib::Vector<float,3> (-8,8,0);
-               m[9][2] = GMlib::Vector<float,3> (-6,8,0);
-               m[9][3] = GMlib::Vector<float,3> (-4,8,0);
-               m[9][4] = GMlib::Vector<float,3> (-2,8,0);
-               m[9][5] = GMlib::Vector<float,3> (0,8,0);
-               m[9][6] = GMlib::Vector<float,3> (2,8,0);
-               m[9][7] = GMlib::Vector<float,3> (4,8,0);
-               m[9][8] = GMlib::Vector<float,3> (6,8,0);
-               m[9][9] = GMlib::Vector<float,3> (8,8,0);
-               m[9][10] = GMlib::Vector<float,3> (10,8,0);
-
-               m[10][0] = GMlib::Vector<float,3> (-10,10,0);
-               m[10][1] = GMlib::Vector<float,3> (-8,10,0);
-               m[10][2] = GMlib::Vector<float,3> (-6,10,0);
-               m[10][3] = GMlib::Vector<float,3> (-4,10,0);
-               m[10][4] = GMlib::Vector<float,3> (-2,10,0);
-               m[10][5] = GMlib::Vector<float,3> (0,10,0);
-               m[10][6] = GMlib::Vector<float,3> (2,10,0);
-               m[10][7] = GMlib::Vector<float,3> (4,10,0);
-               m[10][8] = GMlib::Vector<float,3> (6,10,0);
-               m[10][9] = GMlib::Vector<float,3> (8,10,0);
-               m[10][10] = GMlib::Vector<float,3> (10,10,0);
-
-               auto floor = new GMlib::PBezierSurf<float>(m);
+               //adding curved Bezier surface based on matrix 11*11 (see demoscene.cpp)
+               auto floor = createDemoFloor();
                floor->toggleDefaultVisualizer();
                floor->replot(40,40,1,1);
                //floor->setMaterial(GMlib::GMmaterial::Jade);
@@ -599,52 +552,48 @@ void GMlibWrapper::initScene() {
 
 
            //test balls----------------------------------------
-           auto ball1 = new Ball(1,5,GMlib::Vector<float,3>(5,5,0), floor); //5,5,0 5,0,0
+           //balls must be placed before they are inserted, the controller takes over their state
+           auto ball1 = new Ball(1,5,GMlib::Vector<float,3>(5,5,0)); //5,5,0 5,0,0
+           ball1->translate(GMlib::Point<float,3>(-9,-9,1)); //-9,-9,1 -5,0,1
            colController->insertBall(ball1);
            ball1->insertVisualizer(surface_visualizer);
            ball1->replot(100,100,1,1);
            ball1->setMaterial(GMlib::GMmaterial::Obsidian);
-           ball1->translate(GMlib::Point<float,3>(-9,-9,1)); //-9,-9,1 -5,0,1
 
 
-           auto ball2 = new Ball(1,5,GMlib::Vector<float,3>(-5,-5,0), floor); //-5,-5,0 -5,0,0
+           auto ball2 = new Ball(1,5,GMlib::Vector<float,3>(-5,-5,0)); //-5,-5,0 -5,0,0
+           ball2->translate(GMlib::Point<float,3>(9,9,1)); //9,9,1 5,0,1
            colController->insertBall(ball2);
            ball2->insertVisualizer(surface_visualizer);
            ball2->replot(100,100,1,1);
            ball2->setMaterial(GMlib::GMmaterial::Ruby);
-           ball2->translate(GMlib::Point<float,3>(9,9,1)); //9,9,1 5,0,1
 
 
             //player controlled ball
-           _contrBall = new Ball(1,5,GMlib::Vector<float,3>(0,5,0), floor);
+           _contrBall = new Ball(1,5,GMlib::Vector<float,3>(0,5,0));
+           _contrBall->translate(GMlib::Point<float,3>(0,5,1));
            colController->insertBall(_contrBall);
            _contrBall->insertVisualizer(surface_visualizer);
            _contrBall->replot(100,100,1,1);
            _contrBall->setMaterial(GMlib::GMmaterial::Emerald);
-           _contrBall->translate(GMlib::Point<float,3>(0,5,1));
-
-           //-------------------------------------------------
 
+           //balls for spawning, tessellated now so spawning only places them
+           _ballPool.reset(new BallPool(colController, surface_visualizer, 0.5f, GMlib::GMmaterial::Silver));
+           _ballPool->reserve(64);
 
-           wallN->toggleDefaultVisualizer();
-           wallN->replot(30,30,1,1);
-           wallN->setMaterial(GMlib::GMmaterial::Gold);
-           colController->insertWall(wallN);
+           //-------------------------------------------------
 
-           wallS->toggleDefaultVisualizer();
-           wallS->replot(30,30,1,1);
-           wallS->setMaterial(GMlib::GMmaterial::Gold);
-           colController->insertWall(wallS);
 
-           wallE->toggleDefaultVisualizer();
-           wallE->replot(30,30,1,1);
-           wallE->setMaterial(GMlib::GMmaterial::Gold);
-           colController->insertWall(wallE);
+           for (PWall* wall : walls)
+           {
+               wall->toggleDefaultVisualizer();
+               wall->replot(30,30,1,1);
+               wall->setMaterial(GMlib::GMmaterial::Gold);
+               colController->insertWall(wall);
+           }
 
-           wallW->toggleDefaultVisualizer();
-           wallW->replot(30,30,1,1);
-           wallW->setMaterial(GMlib::GMmaterial::Gold);
-           colController->insertWall(wallW);
+           //physics runs next to rendering from here on, input goes through the controller's command queue
+           colController->startSimulationThread();
 
 #endif
 
@@ -657,12 +606,36 @@ GMlibWrapper::getScene() const {
   return _scene;
 }
 
-const GMlib::TextureRenderTarget&
+std::shared_ptr<const GMlib::TextureRenderTarget>
 GMlibWrapper::getRenderTextureOf(const std::string& name) const {
 
   if(!_rc_pairs.count(name)) throw std::invalid_argument("[][]Render/Camera pair '" + name + "'  does not exist!");
 
-  return _rc_pairs.at(name).render->getFrontRenderTarget();
+  std::lock_guard<std::mutex> lock(_rc_mutex);
+  const std::shared_ptr<GMlib::DefaultRenderer> render = _rc_pairs.at(name).render;
+  if( !render )
+    return nullptr;
+
+  // shares ownership of the renderer, which owns the target
+  return std::shared_ptr<const GMlib::TextureRenderTarget>(render, &render->getFrontRenderTarget());
+}
+
+int
+GMlibWrapper::getActiveViewCount() const {
+
+  int count = 0;
+  for( const auto& rc_pair : _rc_pairs )
+    if( rc_pair.second.render && !rc_pair.second.view.paused )
+      ++count;
+  return count;
+}
+
+double
+GMlibWrapper::getRenderTimeOf(const std::string& name) const {
+
+  if(!_rc_pairs.count(name)) throw std::invalid_argument("[][]Render/Camera pair '" + name + "'  does not exist!");
+
+  return _rc_pairs.at(name).view.render_ms;
 }
 
 void
@@ -683,6 +656,7 @@ GMlibWrapper::mousePressed(const QString& name, QMouseEvent* event ) {
 
         auto& rc   = _rc_pairs.at(name.toStdString());
         auto cam   =  rc.camera.get();
+        if(!cam) return; // the view is not shown yet or hidden again
 
         if(event->button() == Qt::RightButton)
         {
@@ -793,6 +767,7 @@ void GMlibWrapper::mouseMoved(const QString &name, QMouseEvent *event)
 
         auto& rc    = _rc_pairs.at(name.toStdString());
         auto  cam   = rc.camera.get();
+        if(!cam) return; // the view is not shown yet or hidden again
         float SNAP  = 0.01f;
 
         if(_move_object_button_pressed)
@@ -989,6 +964,24 @@ GMlibWrapper::keyPressed(const QString& name, QKeyEvent* event) {
         _glsurface->doneCurrent();
     }
 
+    if(event->key() == Qt::Key_B && _ballPool)
+    {
+        _glsurface->makeCurrent(); //a miss makes and replots a new ball
+
+        std::uniform_real_distribution<float> place(-8.0f, 8.0f);
+        std::uniform_real_distribution<float> speed(-5.0f, 5.0f);
+        _spawned.push_back(_ballPool->acquire(GMlib::Point<float,3>(place(_spawnRng), place(_spawnRng), 1),
+                                              GMlib::Vector<float,3>(speed(_spawnRng), speed(_spawnRng), 0), 2));
+
+        _glsurface->doneCurrent();
+    }
+
+    if(event->key() == Qt::Key_N && !_spawned.empty())
+    {
+        _ballPool->release(_spawned.back());
+        _spawned.pop_back();
+    }
+
     if(event->key() == Qt::Key_Up)
     {
         _contrBall->moveUp();
@@ -1028,13 +1021,15 @@ void GMlibWrapper::wheelEventOccurred(const QString& name, QWheelEvent* event) {
 
     const auto& camera_geo = rc.viewport.geometry;
     auto camera    = rc.camera.get();
+    if(!camera) return; // the view is not shown yet or hidden again
+
     auto isocamera = dynamic_cast<GMlib::IsoCamera*>(camera);
     if(isocamera) {
 
         if( delta < 0 ) isocamera->zoom( 1.05 );
         if( delta > 0 ) isocamera->zoom( 0.95 );
     }
-    else if(camera) {
+    else {
 
         double scale;
         if( camera->isLocked() )
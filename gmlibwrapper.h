@@ -2,6 +2,7 @@
 class TestTorus;
 class GLContextSurfaceWrapper;
 class Ball;
+class BallPool;
 
 // gmlib
 #include <core/gmpoint>
@@ -31,18 +32,36 @@ class QWheelEvent;
 
 
 // stl
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <unordered_map>
+#include <vector>
 
 
+// Render/camera pair of a named view. The renderer and camera only exist while
+// a GLSceneRenderer with that name is visible, setup configures a new camera.
 struct RenderCamPair {
   RenderCamPair() : render{nullptr}, camera{nullptr} {}
   std::shared_ptr<GMlib::DefaultRenderer>     render;
   std::shared_ptr<GMlib::Camera>              camera;
+  std::function<void(RenderCamPair&)>         setup;
   struct {
     QRectF                      geometry { QRectF(0,0,200,200) };
     bool                        changed {true};
   } viewport;
+  struct {
+    int                         users {0};        // visible GLSceneRenderers with this name
+    bool                        paused {false};
+    double                      render_ms {0.0};  // render and swap of the last frame
+  } view;
+  struct {
+    bool                        valid {false};    // camera frame kept while the view is hidden
+    GMlib::Point<float,3>       pos;
+    GMlib::Vector<float,3>      dir;
+    GMlib::Vector<float,3>      up;
+  } saved_camera;
 };
 
 
@@ -59,7 +78,12 @@ public:
   void                                  stop();
 
   const std::shared_ptr<GMlib::Scene>&  getScene() const;
-  const GMlib::TextureRenderTarget&     getRenderTextureOf( const std::string& name ) const;
+  // null while the view is hidden, the copy keeps the render target alive while it is drawn
+  std::shared_ptr<const GMlib::TextureRenderTarget>
+                                        getRenderTextureOf( const std::string& name ) const;
+
+  int                                   getActiveViewCount() const;
+  double                                getRenderTimeOf( const std::string& name ) const;
 
   void                                  initScene();
 
@@ -67,6 +91,8 @@ public:
 public slots:
   void                                  changeRenderGeometry( const QString& name,
                                                               const QRectF &new_geometry );
+  void                                  changeViewVisibility( const QString& name, bool visible );
+  void                                  changeViewPaused( const QString& name, bool paused );
 
 
 
@@ -89,6 +115,8 @@ private:
 
   std::shared_ptr<GMlib::Scene>                     _scene;
   std::unordered_map<std::string, RenderCamPair>    _rc_pairs;
+  mutable std::mutex                                _rc_mutex;          // render of the pairs, read on the render thread
+  std::vector<std::shared_ptr<GMlib::DefaultRenderer>> _released_renders;  // freed here once the render thread let go
   std::shared_ptr<GMlib::DefaultSelectRenderer>     _select_renderer;
 
   int                                               _replot_low_medium_high {1};
@@ -99,6 +127,13 @@ private:
   GMlib::Point<int,2>                               _prev_mouse_pos;
 
   Ball*                                             _contrBall; //for player controlled ball
+  std::unique_ptr<BallPool>                         _ballPool;  //balls spawned with B and removed with N
+  std::vector<Ball*>                                _spawned;
+  std::mt19937                                      _spawnRng;
+
+  void                                              createRenderCamPair( RenderCamPair& rc_pair );
+  void                                              releaseRenderCamPair( RenderCamPair& rc_pair );
+  void                                              freeReleasedRenders( bool all );   // with the GL context current
 
 signals:
   void                                              signFrameReady();
@@ -60,40 +60,29 @@
   PBiPlane<T>::~PBiPlane() {}
 
 
+  template <typename T>
+  const GMlib::Point<T,3>& PBiPlane<T>::getCorner( int i ) const {
+
+    switch( i ) {
+      case 0:   return _p1;
+      case 1:   return _p2;
+      case 2:   return _p3;
+      default:  return _p4;
+    }
+  }
+
+
   template <typename T>
   void PBiPlane<T>::eval(T u, T v, int d1, int d2, bool /*lu*/, bool /*lv*/ ) {
 
     this->_p.setDim( d1+1, d2+1 );
 
-    this->_p[0][0] = _p1 + u * (_p2 - _p1) + v * (_p4 - _p1 + u *
-                    (_p1 - _p2 + _p3 - _p4)) ;
-
-    if( this->_dm == GMlib::GM_DERIVATION_EXPLICIT ) {
-
-      // 1st
-      if(d1)            this->_p[1][0] = _p2 - _p1 + v *
-                                        (_p1 - _p2 + _p3 - _p4); // S_u
-      if(d2)            this->_p[0][1] = _p4 - _p1 + u *
-                                        (_p1 - _p2 + _p3 - _p4); // S_v
-      if(d1>1 && d2>1)  this->_p[1][1] = _p1 - _p2 + _p3 - _p4; // S_uv
-
-      // 2nd
-      if(d1>1)          this->_p[2][0] = GMlib::Vector<T,3>(T(0)); // S_uu
-      if(d2>1)          this->_p[0][2] = GMlib::Vector<T,3>(T(0)); // S_vv
-      if(d1>1 && d2)    this->_p[2][1] = GMlib::Vector<T,3>(T(0)); // S_uuv
-      if(d1   && d2>1)  this->_p[1][2] = GMlib::Vector<T,3>(T(0)); // S_uvv
-      if(d1>1 && d2>1)  this->_p[2][2] = GMlib::Vector<T,3>(T(0)); // S_uuvv
-	  
-	  // 3rd
-      if(d1>2)          this->_p[3][0] = GMlib::Vector<T,3>(T(0)); // S_uuu
-      if(d2>2)          this->_p[0][3] = GMlib::Vector<T,3>(T(0)); // S_vvv
-      if(d1>2 && d2)    this->_p[3][1] = GMlib::Vector<T,3>(T(0)); // S_uuuv
-      if(d1   && d2>2)  this->_p[1][3] = GMlib::Vector<T,3>(T(0)); // S_uvvv
-      if(d1>2 && d2>1)  this->_p[3][2] = GMlib::Vector<T,3>(T(0)); // S_uuuvv
-      if(d1>1 && d2>2)  this->_p[2][3] = GMlib::Vector<T,3>(T(0)); // S_uuvvv
-      if(d1>2 && d2>2)  this->_p[3][3] = GMlib::Vector<T,3>(T(0)); // S_uuuvvv
+    // bilinear patch as a degree (1,1) Bezier patch
+    const GMlib::Vector<T,3> net[2][2] = { { _p1, _p4 }, { _p2, _p3 } };
 
-    }
+    // fixed degree basis on the stack, no DVector temporaries
+    const bool derivatives = this->_dm == GMlib::GM_DERIVATION_EXPLICIT;
+    Bernstein::evaluate<T,1,1>( net, u, v, derivatives ? d1 : 0, derivatives ? d2 : 0, this->_p );
   }
 
   template <typename T>
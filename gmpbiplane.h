@@ -2,6 +2,7 @@
 #define GMPBIPLANE
 
 #include "../gmlib/modules/parametrics/src/gmpsurf.h"
+#include "bernstein.h"
 
   template <typename T>
   class PBiPlane : public GMlib::PSurf<T,3> {
@@ -11,6 +12,8 @@
     PBiPlane( const PBiPlane<T>& copy );
     virtual ~PBiPlane();
 
+    const GMlib::Point<T,3>&  getCorner( int i ) const;
+
   protected:
     GMlib::Point<T,3>       _p1;
     GMlib::Point<T,3>		_p2;
@@ -2,6 +2,7 @@
 #define GMPCURPLANE
 
 #include "../gmlib/modules/parametrics/src/gmpsurf.h"
+#include "bernstein.h"
 
   template <typename T>
   class PCurPlane : public GMlib::PSurf<T,3> {
@@ -11,6 +12,8 @@
     PCurPlane( const PCurPlane<T>& copy );
     virtual ~PCurPlane();
 
+    const GMlib::DMatrix<GMlib::Vector<T,3>>&  getControlNet() const;
+
   protected:
     GMlib::DMatrix<GMlib::Vector<T,3>> _m;
 
@@ -51,6 +51,8 @@ GuiApplication::onSGInit() {
 //  connect( _gmlib.get(),  &GMlibWrapper::signFrameReady,   _window.get(), &Window::signFrameReady );
   connect( _gmlib.get(),  &GMlibWrapper::signFrameReady,   _window.get(), &Window::update );
   connect( _window.get(), &Window::signGuiViewportChanged, _gmlib.get(),  &GMlibWrapper::changeRenderGeometry );
+  connect( _window.get(), &Window::signGuiViewVisibilityChanged, _gmlib.get(), &GMlibWrapper::changeViewVisibility );
+  connect( _window.get(), &Window::signGuiViewPausedChanged, _gmlib.get(), &GMlibWrapper::changeViewPaused );
 
   // Load gui qml
   _window->setSource( QUrl("qrc:/qml/main.qml") );
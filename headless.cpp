@@ -0,0 +1,612 @@
+// Headless driver: steps the demo arena as fast as possible, no window, GL context or QML
+
+// local
+#include "alloccounter.h"
+#include "collisionqueue.h"
+#include "controller.h"
+#include "demoscene.h"
+#include "gmpbiplane.h"
+#include "gmpcurplane.h"
+#include "perfcounter.h"
+
+// stl
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+  struct Options {
+    int     balls     {100};
+    int     frames    {1000};
+    double  dt        {1.0 / 60.0};
+    int     threads   {1};
+    float   cell_size {4.0f};
+    float   radius    {0.5f};
+    int     seed      {1};
+    float   proj_tol  {1e-5f};
+    int     proj_iters{8};
+    std::string floor {"exact"};
+    int     grid_res  {128};
+    int     bench_eval{0};
+    int     bench_queue{0};
+    int     thread_sweep{0};
+    int     check_alloc{-1};
+    int     sleep_frames{30};
+    std::string broad_phase {"hash"};
+    int     islands   {1};
+    float   skin      {0.5f};
+    std::string toi   {"auto"};
+    int     reorder   {0};
+    int     churn     {0};
+  };
+
+  void printUsage() {
+
+    std::cout << "usage: BallSimHeadless"
+                 " [--balls N] [--frames N] [--dt S] [--threads N] [--radius R] [--seed N] [--churn N] [--sleep-frames N]\n"
+                 "  collisions: [--broad-phase hash|sap|verlet] [--cell-size S] [--skin S] [--islands 0|1]"
+                 " [--toi auto|scalar|avx2|avx512|off] [--reorder FRAMES]\n"
+                 "  floor:      [--floor exact|grid|refined] [--grid-res N] [--proj-tol T] [--proj-iters N]\n"
+                 "  tools:      [--check-alloc WARMUP] [--bench-eval N] [--bench-queue EVENTS] [--thread-sweep MAX]"
+              << std::endl;
+  }
+
+  // one parser and one check per group of options, a parser returns false for
+  // an option of another group
+
+  bool parseSceneOption(Options& opt, const std::string& arg, const std::string& value) {
+
+    if(      arg == "--balls" )     opt.balls     = std::stoi(value);
+    else if( arg == "--frames" )    opt.frames    = std::stoi(value);
+    else if( arg == "--dt" )        opt.dt        = std::stod(value);
+    else if( arg == "--threads" )   opt.threads   = std::stoi(value);
+    else if( arg == "--radius" )    opt.radius    = std::stof(value);
+    else if( arg == "--seed" )      opt.seed      = std::stoi(value);
+    else if( arg == "--churn" )     opt.churn     = std::stoi(value);
+    else if( arg == "--sleep-frames" ) opt.sleep_frames = std::stoi(value);
+    else return false;
+    return true;
+  }
+
+  void checkSceneOptions(const Options& opt) {
+
+    if( opt.balls < 0 || opt.frames < 0 || opt.dt <= 0.0 )
+      throw std::invalid_argument("--balls and --frames must be >= 0 and --dt > 0");
+    if( opt.churn < 0 || opt.churn > opt.balls )
+      throw std::invalid_argument("--churn must be between 0 and --balls");
+  }
+
+  bool parseCollisionOption(Options& opt, const std::string& arg, const std::string& value) {
+
+    if(      arg == "--broad-phase" ) opt.broad_phase = value;
+    else if( arg == "--cell-size" )   opt.cell_size   = std::stof(value);
+    else if( arg == "--skin" )        opt.skin        = std::stof(value);
+    else if( arg == "--islands" )     opt.islands     = std::stoi(value);
+    else if( arg == "--toi" )         opt.toi         = value;
+    else if( arg == "--reorder" )     opt.reorder     = std::stoi(value);
+    else return false;
+    return true;
+  }
+
+  void checkCollisionOptions(const Options& opt) {
+
+    if( opt.broad_phase != "hash" && opt.broad_phase != "sap" && opt.broad_phase != "verlet" )
+      throw std::invalid_argument("--broad-phase must be hash, sap or verlet");
+    if( opt.skin < 0.0f )
+      throw std::invalid_argument("--skin must be >= 0");
+    if( opt.toi != "auto" && opt.toi != "scalar" && opt.toi != "avx2" && opt.toi != "avx512" && opt.toi != "off" )
+      throw std::invalid_argument("--toi must be auto, scalar, avx2, avx512 or off");
+    if( opt.reorder < 0 )
+      throw std::invalid_argument("--reorder must be >= 0");
+  }
+
+  bool parseFloorOption(Options& opt, const std::string& arg, const std::string& value) {
+
+    if(      arg == "--floor" )      opt.floor      = value;
+    else if( arg == "--grid-res" )   opt.grid_res   = std::stoi(value);
+    else if( arg == "--proj-tol" )   opt.proj_tol   = std::stof(value);
+    else if( arg == "--proj-iters" ) opt.proj_iters = std::stoi(value);
+    else return false;
+    return true;
+  }
+
+  void checkFloorOptions(const Options& opt) {
+
+    if( opt.floor != "exact" && opt.floor != "grid" && opt.floor != "refined" )
+      throw std::invalid_argument("--floor must be exact, grid or refined");
+  }
+
+  bool parseToolOption(Options& opt, const std::string& arg, const std::string& value) {
+
+    if(      arg == "--check-alloc" )  opt.check_alloc  = std::stoi(value);
+    else if( arg == "--bench-eval" )   opt.bench_eval   = std::stoi(value);
+    else if( arg == "--bench-queue" )  opt.bench_queue  = std::stoi(value);
+    else if( arg == "--thread-sweep" ) opt.thread_sweep = std::stoi(value);
+    else return false;
+    return true;
+  }
+
+  void checkToolOptions(const Options& opt) {
+
+    if( opt.bench_eval < 0 || opt.bench_queue < 0 || opt.thread_sweep < 0 )
+      throw std::invalid_argument("--bench-eval, --bench-queue and --thread-sweep must be >= 0");
+  }
+
+  Options parseOptions(int argc, char* argv[]) {
+
+    Options opt;
+    for( int i = 1; i < argc; ++i ) {
+
+      const std::string arg = argv[i];
+      if( arg == "--help" || arg == "-h" ) {
+        printUsage();
+        exit(0);
+      }
+
+      if( i + 1 >= argc )
+        throw std::invalid_argument("Missing value for option '" + arg + "'");
+      const std::string value = argv[++i];
+
+      if( !parseSceneOption(opt, arg, value) && !parseCollisionOption(opt, arg, value) &&
+          !parseFloorOption(opt, arg, value) && !parseToolOption(opt, arg, value) )
+        throw std::invalid_argument("Unknown option '" + arg + "'");
+    }
+
+    checkSceneOptions(opt);
+    checkCollisionOptions(opt);
+    checkFloorOptions(opt);
+    checkToolOptions(opt);
+    return opt;
+  }
+
+  // applies the options to a new controller, returns the time the height field took to build
+  double configure(Controller& controller, const Options& opt, int threads) {
+
+    controller.setThreadCount(threads);
+    controller.setParallelIslands(opt.islands != 0);
+    controller.setCellSize(opt.cell_size);
+    if( opt.broad_phase == "sap" )
+      controller.setBroadPhase(BroadPhaseKind::SweepAndPrune);
+    else if( opt.broad_phase == "verlet" )
+      controller.setBroadPhase(BroadPhaseKind::VerletList);
+    else
+      controller.setBroadPhase(BroadPhaseKind::SpatialHash);
+    controller.setVerletSkin(opt.skin);
+    controller.setReorderInterval(opt.reorder);
+
+    controller.setBatchedPairTests(opt.toi != "off");
+    if( opt.toi == "scalar" || opt.toi == "avx2" || opt.toi == "avx512" ) {
+      const ToiKernel::Isa isa = opt.toi == "scalar" ? ToiKernel::Isa::Scalar
+                               : opt.toi == "avx2"   ? ToiKernel::Isa::Avx2 : ToiKernel::Isa::Avx512;
+      if( !controller.getToiKernel().setIsa(isa) )
+        throw std::runtime_error("--toi " + opt.toi + " is not supported by this cpu");
+    }
+    controller.setProjectionTolerance(opt.proj_tol);
+    controller.setMaxProjectionIterations(opt.proj_iters);
+    controller.setSleepThresholds(0.05f, 0.002f, opt.sleep_frames);
+
+    if( opt.floor == "exact" )
+      return 0.0;
+
+    const FloorQuality quality = opt.floor == "grid" ? FloorQuality::HeightField : FloorQuality::Refined;
+    const auto build_start = std::chrono::steady_clock::now();
+    if( !controller.setFloorQuality(quality, opt.grid_res) )
+      throw std::runtime_error("the floor can not be sampled as a height field");
+    return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - build_start).count();
+  }
+
+  // balls on a jittered grid inside the walls, shrunk if they do not fit
+  void spawnBalls(Controller& controller, const Options& opt, float& radius, std::vector<int>& handles) {
+
+    const int   side    = std::max(1, int(std::ceil(std::sqrt(double(opt.balls)))));
+    const float spacing = 18.0f / side;
+    radius = std::min(opt.radius, 0.4f * spacing);
+
+    std::mt19937 rng(opt.seed);
+    std::uniform_real_distribution<float> jitter(-0.05f * spacing, 0.05f * spacing);
+    std::uniform_real_distribution<float> speed(-5.0f, 5.0f);
+
+    for( int k = 0; k < opt.balls; ++k ) {
+
+      const float x = -9.0f + spacing * (0.5f + k % side) + jitter(rng);
+      const float y = -9.0f + spacing * (0.5f + k / side) + jitter(rng);
+      handles.push_back(controller.addBall(GMlib::Point<float,3>(x, y, 1.0f),
+                                           GMlib::Vector<float,3>(speed(rng), speed(rng), 0.0f), radius, 5.0));
+    }
+  }
+
+  // removes count random balls and adds as many at random places, returns the
+  // number of removed handles that were rejected when used again
+  int churnBalls(Controller& controller, std::vector<int>& handles, int count, float radius, std::mt19937& rng) {
+
+    std::uniform_real_distribution<float> place(-8.5f, 8.5f);
+    std::uniform_real_distribution<float> speed(-5.0f, 5.0f);
+
+    int rejected = 0;
+    for( int k = 0; k < count; ++k ) {
+
+      const int pick = std::uniform_int_distribution<int>(0, int(handles.size()) - 1)(rng);
+      const int handle = handles[pick];
+      controller.removeBall(handle);
+      if( !controller.removeBall(handle) && !controller.getStore().isValid(handle) )
+        rejected++;
+
+      handles[pick] = controller.addBall(GMlib::Point<float,3>(place(rng), place(rng), 1.0f),
+                                         GMlib::Vector<float,3>(speed(rng), speed(rng), 0.0f), radius, 5.0);
+    }
+    return rejected;
+  }
+
+  // FNV-1a over the bits of all positions and velocities, equal runs give equal sums.
+  // The balls are taken by handle, so the sum does not depend on the order of the store
+  unsigned long long stateChecksum(const BallStore& store) {
+
+    unsigned long long h = 14695981039346656037ull;
+    auto add = [&h](const GMlib::Vector<float,3>& p) {
+      unsigned char bytes[3 * sizeof(float)];
+      for( int k = 0; k < 3; ++k )
+        std::memcpy(bytes + k * sizeof(float), &p(k), sizeof(float));
+      for( unsigned char b : bytes ) {
+        h ^= b;
+        h *= 1099511628211ull;
+      }
+    };
+
+    std::vector<std::pair<int,int>> balls;
+    for( int i = 0; i < store.size(); ++i )
+      balls.push_back(std::make_pair(store.getHandle(i), i));
+    std::sort(balls.begin(), balls.end());
+
+    for( const std::pair<int,int>& ball : balls ) {
+      add(store.getPos(ball.second));
+      add(store.getVelocity(ball.second));
+    }
+    return h;
+  }
+
+  // runs the scene with 1, 2, 4, ... up to max threads; threads must not change the result
+  void threadSweep(const Options& opt, int max) {
+
+    double serial_ms = 0.0;
+    unsigned long long serial_sum = 0;
+    for( int threads = 1; ; threads = std::min(2 * threads, max) ) {
+
+      auto floor = createDemoFloor();
+      Controller controller(floor);
+      for( PWall* wall : createDemoWalls() )
+        controller.insertWall(wall);
+      configure(controller, opt, threads);
+
+      float radius;
+      std::vector<int> handles;
+      spawnBalls(controller, opt, radius, handles);
+
+      const auto start = std::chrono::steady_clock::now();
+      for( int f = 0; f < opt.frames; ++f )
+        controller.step(opt.dt);
+      const double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count()
+                      / std::max(1, opt.frames);
+      const unsigned long long sum = stateChecksum(controller.getStore());
+      if( threads == 1 ) {
+        serial_ms = ms;
+        serial_sum = sum;
+      }
+
+      std::cout << "threads " << threads << ": " << ms << " ms per frame, speedup " << serial_ms / ms
+                << ", checksum " << std::hex << sum << std::dec << (sum == serial_sum ? "" : " DIFFERS") << std::endl;
+      if( threads >= max )
+        break;
+    }
+  }
+
+  // the PCurPlane evaluation before it moved to the fixed degree basis, kept as reference
+  void referenceCurPlaneEval(const GMlib::DMatrix<GMlib::Vector<float,3>>& m, float u, float v,
+                             GMlib::Vector<float,3>& s, GMlib::Vector<float,3>& su, GMlib::Vector<float,3>& sv) {
+
+    GMlib::DVector<float> u1(3);
+    u1[0] = (1-u)*(1-u);
+    u1[1] = 2*u*(1-u);
+    u1[2] = u*u;
+
+    GMlib::DVector<float> v1(3);
+    v1[0] = (1-v)*(1-v);
+    v1[1] = 2*v*(1-v);
+    v1[2] = v*v;
+
+    GMlib::DVector<float> uu1(3);
+    uu1[0] = -2*(1-u);
+    uu1[1] = 2 - 4*u;
+    uu1[2] = 2*u;
+
+    GMlib::DVector<float> vv1(3);
+    vv1[0] = -2*(1-v);
+    vv1[1] = 2 - 4*v;
+    vv1[2] = 2*v;
+
+    s  = u1*(m^v1);
+    su = uu1*(m^v1);
+    sv = u1*(m^vv1);
+  }
+
+  // times evaluate(u,v,1,1) of the curved floor against the reference evaluation
+  void benchmarkEval(int count) {
+
+    GMlib::DMatrix<GMlib::Vector<float,3>> m(3, 3);
+    for( int i = 0; i < 3; ++i )
+      for( int j = 0; j < 3; ++j )
+        m[i][j] = GMlib::Vector<float,3>(10.0f * (i - 1), 10.0f * (j - 1), (i == 1 && j == 1) ? 4.0f : 0.0f);
+    PCurPlane<float> surface(m);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> param(0.0f, 1.0f);
+    std::vector<float> us(1024), vs(1024);
+    for( size_t k = 0; k < us.size(); ++k ) {
+      us[k] = param(rng);
+      vs[k] = param(rng);
+    }
+
+    GMlib::Vector<float,3> s, su, sv;
+    float sink = 0.0f;
+    double max_diff = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for( int k = 0; k < count; ++k ) {
+      referenceCurPlaneEval(m, us[k & 1023], vs[k & 1023], s, su, sv);
+      sink += s(2) + su(0) + sv(1);
+    }
+    const double reference_ns = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for( int k = 0; k < count; ++k ) {
+      const GMlib::DMatrix<GMlib::Vector<float,3>>& p = surface.evaluate(us[k & 1023], vs[k & 1023], 1, 1);
+      sink += p[0][0](2) + p[1][0](0) + p[0][1](1);
+    }
+    const double fixed_ns = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    for( size_t k = 0; k < us.size(); ++k ) {
+      referenceCurPlaneEval(m, us[k], vs[k], s, su, sv);
+      const GMlib::DMatrix<GMlib::Vector<float,3>>& p = surface.evaluate(us[k], vs[k], 1, 1);
+      max_diff = std::max(max_diff, double((p[0][0] - s).getLength()));
+      max_diff = std::max(max_diff, double((p[1][0] - su).getLength()));
+      max_diff = std::max(max_diff, double((p[0][1] - sv).getLength()));
+    }
+
+    const double calls = std::max(1, count);
+    std::cout << "evaluations:       " << count << " (checksum " << sink << ")" << std::endl;
+    std::cout << "reference eval:    " << reference_ns / calls << " ns" << std::endl;
+    std::cout << "fixed degree eval: " << fixed_ns / calls << " ns (evaluate, d = 1,1)" << std::endl;
+    std::cout << "max difference:    " << max_diff << std::endl;
+  }
+
+
+  // the event loop before the heap: sort all collisions, drop the later ones that
+  // share a ball with an earlier one (GMlib's Array::makeUnique, pairwise), take the first
+  Collision popSorted(std::vector<Collision>& cols) {
+
+    std::sort(cols.begin(), cols.end());
+    for( size_t i = 0; i < cols.size(); ++i )
+      for( size_t j = cols.size() - 1; j > i; --j ) {
+        const Collision& a = cols[i];
+        const Collision& b = cols[j];
+        if( a.hasBall(b.getBall(0)) || (!b.isColBW() && a.hasBall(b.getBall(1))) )
+          cols.erase(cols.begin() + j);
+      }
+
+    const Collision col = cols.front();
+    cols.erase(cols.begin());
+    return col;
+  }
+
+  // times the event loop of the old sorted array against CollisionQueue: each handled
+  // collision changes both balls and predicts one new collision for each. The streams
+  // part after a while, the sorted array also drops collisions that only shared a ball
+  // with one that went stale before it was handled
+  void benchmarkQueue(int events) {
+
+    auto floor = createDemoFloor();
+    for( int balls : {100, 1000, 10000} ) {
+
+      BallStore store(floor);
+      for( int k = 0; k < balls; ++k )
+        store.add(GMlib::Point<float,3>(0, 0, 1), GMlib::Vector<float,3>(0, 0, 0), 0.1f, 1.0);
+
+      double ms[2];
+      for( int variant = 0; variant < 2; ++variant ) {
+
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> other(0, balls - 1);
+        std::uniform_real_distribution<double> later(0.0, 1.0);
+        auto predict = [&](int ball, double x) {
+          int partner = other(rng);
+          if( partner == ball )
+            partner = (partner + 1) % balls;
+          return Collision(store, std::min(ball, partner), std::max(ball, partner), x + later(rng));
+        };
+
+        std::vector<Collision> sorted;
+        CollisionQueue queue;
+        for( int k = 0; k < balls; ++k ) {
+          const Collision col = predict(k, 0.0);
+          if( variant == 0 ) sorted.push_back(col);
+          else               queue.push(col);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for( int e = 0; e < events; ++e ) {
+
+          Collision col;
+          if( variant == 0 )
+            col = popSorted(sorted);
+          else {
+            col = queue.pop();
+            while( !col.isValid(store) )
+              col = queue.pop();
+          }
+
+          // both balls change their path, so their queued collisions go stale
+          for( int b = 0; b < 2; ++b )
+            store.setVelocity(col.getBall(b), store.getVelocity(col.getBall(b)));
+          for( int b = 0; b < 2; ++b ) {
+            const Collision next = predict(col.getBall(b), col.getX());
+            if( variant == 0 ) sorted.push_back(next);
+            else               queue.push(next);
+          }
+        }
+        ms[variant] = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+
+      std::cout << "queue, " << balls << " balls: " << 1e6 * ms[0] / events << " ns per event sorted array, "
+                << 1e6 * ms[1] / events << " ns heap" << std::endl;
+    }
+  }
+
+}
+
+
+int main(int argc, char* argv[]) try {
+
+  const Options opt = parseOptions(argc, argv);
+
+  if( opt.bench_eval > 0 ) {
+    benchmarkEval(opt.bench_eval);
+    return 0;
+  }
+  if( opt.bench_queue > 0 ) {
+    benchmarkQueue(opt.bench_queue);
+    return 0;
+  }
+  if( opt.thread_sweep > 0 ) {
+    threadSweep(opt, opt.thread_sweep);
+    return 0;
+  }
+
+  auto floor = createDemoFloor();
+  Controller controller(floor);
+  for( PWall* wall : createDemoWalls() )
+    controller.insertWall(wall);
+
+  const double build_ms = configure(controller, opt, opt.threads);
+  if( opt.floor != "exact" ) {
+
+    const HeightField& field = controller.getStore().getHeightField();
+    std::cout << "height field:      " << field.getResolution() << "^2 cells in " << build_ms << " ms, max error "
+              << field.getMaxHeightError() << " (height) " << field.getMaxNormalError() << " rad (normal)" << std::endl;
+  }
+
+  float radius;
+  std::vector<int> handles;
+  spawnBalls(controller, opt, radius, handles);
+  std::mt19937 churn_rng(opt.seed + 1);
+  long stale_handles = 0;
+
+  long candidate_pairs = 0;
+  long events = 0;
+  long stale_events = 0;
+  double projection_iterations = 0.0;
+  long sleeping = 0;
+  long wall_tests = 0;
+  long islands = 0;
+  long large_islands = 0;
+  long exact_pairs = 0;
+  double pair_span = 0.0;
+
+  const bool counting_misses = PerfCounter::start();
+  const auto start = std::chrono::steady_clock::now();
+  for( int f = 0; f < opt.frames; ++f ) {
+
+    if( f == opt.check_alloc )
+      AllocCounter::start();
+
+    if( opt.churn > 0 )
+      stale_handles += churnBalls(controller, handles, opt.churn, radius, churn_rng);
+    controller.step(opt.dt);
+
+    candidate_pairs += controller.getCandidatePairCount();
+    events          += controller.getEventCount();
+    stale_events    += controller.getStaleEventCount();
+    projection_iterations += controller.getAverageProjectionIterations();
+    sleeping        += controller.getSleepingCount();
+    wall_tests      += controller.getWallTestCount();
+    islands         += controller.getIslandCount();
+    large_islands   += controller.getLargeIslandCount();
+    exact_pairs     += controller.getExactPairTestCount();
+    pair_span       += controller.getAveragePairSpan();
+  }
+  const auto stop = std::chrono::steady_clock::now();
+  const long long cache_misses = counting_misses ? PerfCounter::stop() : -1;
+  const long allocations = opt.check_alloc >= 0 ? AllocCounter::stop() : 0;
+
+  const double seconds = std::chrono::duration<double>(stop - start).count();
+  const double frames  = std::max(1, opt.frames);
+
+  std::cout << "balls:             " << opt.balls << " (radius " << radius << ")" << std::endl;
+  std::cout << "threads:           " << controller.getThreadCount() << std::endl;
+  std::cout << "frames:            " << opt.frames << " (dt " << opt.dt << " s)" << std::endl;
+  std::cout << "wall time:         " << seconds << " s" << std::endl;
+  std::cout << "frames per second: " << (seconds > 0.0 ? opt.frames / seconds : 0.0) << std::endl;
+  std::cout << "ms per frame:      " << 1000.0 * seconds / frames << std::endl;
+  if( opt.broad_phase == "verlet" )
+    std::cout << "broad phase:       verlet lists, skin " << opt.skin << ", rebuilt "
+              << controller.getNeighbourListRebuildCount() << " times, "
+              << controller.getAverageNeighbourCount() << " neighbours per ball" << std::endl;
+  else
+    std::cout << "broad phase:       " << (opt.broad_phase == "sap" ? "sweep and prune" : "spatial hash") << std::endl;
+  std::cout << "pairs per frame:   " << candidate_pairs / frames << std::endl;
+  std::cout << "events per frame:  " << events / frames << " (" << stale_events / frames << " stale)" << std::endl;
+  std::cout << "pair tests:        " << (opt.toi == "off" ? "off" : ToiKernel::getName(controller.getToiKernel().getIsa()))
+            << ", " << exact_pairs / frames << " per frame solved by findBBCol" << std::endl;
+  std::cout << "wall tests:        " << wall_tests / frames << " per frame" << std::endl;
+  std::cout << "parallel islands:  " << islands / frames << " per frame, " << large_islands / frames
+            << " of them through the broad phase, " << controller.getIslandFallbackCount() << " frames redone serially, "
+            << controller.getCrowdedFrameCount() << " left serial with one island holding most balls" << std::endl;
+  if( opt.reorder > 0 )
+    std::cout << "store order:       z-order every " << opt.reorder << " frames, sorted "
+              << controller.getReorderCount() << " times";
+  else
+    std::cout << "store order:       as spawned";
+  std::cout << ", " << pair_span / frames << " slots between paired balls" << std::endl;
+  if( cache_misses >= 0 )
+    std::cout << "cache misses:      " << cache_misses / frames << " per frame (main thread)" << std::endl;
+  else
+    std::cout << "cache misses:      not counted, no hardware counter" << std::endl;
+  if( opt.churn > 0 )
+    std::cout << "churn:             " << opt.churn << " balls removed and added per frame, " << stale_handles
+              << " of " << long(opt.churn) * opt.frames << " removed handles rejected when used again" << std::endl;
+  std::cout << "floor:             " << opt.floor << std::endl;
+  std::cout << "newton steps:      " << projection_iterations / frames << " per projection" << std::endl;
+  std::cout << "sleeping balls:    " << sleeping / frames << " per frame, " << controller.getSleepingCount()
+            << " asleep and " << opt.balls - controller.getSleepingCount() << " awake at the end" << std::endl;
+  std::cout << "state checksum:    " << std::hex << stateChecksum(controller.getStore()) << std::dec << std::endl;
+
+  if( opt.check_alloc >= 0 ) {
+    const int counted = std::max(0, opt.frames - opt.check_alloc);
+    std::cout << "heap allocations:  " << allocations << " in " << counted << " frames after "
+              << opt.check_alloc << " warm-up frames" << std::endl;
+    if( allocations > 0 )
+      return 1;
+  }
+
+  return 0;
+}
+catch(const std::invalid_argument& e) {
+  std::cerr << "std::invalid_argument " << e.what() << std::endl;
+  printUsage();
+  exit(1);
+}
+catch(const std::exception& e) {
+  std::cerr << "std::exception : " << e.what() << std::endl;
+  exit(1);
+}
+catch(...) {
+  std::cerr << "exception!!" << std::endl;
+  exit(1);
+}
@@ -0,0 +1,246 @@
+#include "heightfield.h"
+
+// stl
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+  // surface point straight above or below (x,y), Newton on the xy part of S(u,v)
+  bool solveXY(GMlib::PSurf<float,3>& surface, float x, float y, float& u, float& v,
+               GMlib::Point<float,3>& point, GMlib::Vector<float,3>& normal, float tolerance) {
+
+    const float u0 = surface.getParStartU(), u1 = u0 + surface.getParDeltaU();
+    const float v0 = surface.getParStartV(), v1 = v0 + surface.getParDeltaV();
+
+    for( int it = 0; it < 30; ++it ) {
+
+      const GMlib::DMatrix<GMlib::Vector<float,3>>& m = surface.evaluate(u, v, 1, 1);
+      point  = m[0][0];
+      normal = GMlib::UnitVector<float,3>(m[0][1] ^ m[1][0]);
+
+      const double ex = m[0][0](0) - x;
+      const double ey = m[0][0](1) - y;
+      if( std::abs(ex) + std::abs(ey) < tolerance )
+        return true;
+
+      const double a = m[1][0](0), b = m[0][1](0);
+      const double c = m[1][0](1), d = m[0][1](1);
+      const double det = a * d - b * c;
+      if( std::abs(det) < 1e-20 )
+        return false;
+
+      u = std::min(u1, std::max(u0, float(u - ( d * ex - b * ey) / det)));
+      v = std::min(v1, std::max(v0, float(v - (-c * ex + a * ey) / det)));
+    }
+    return false;
+  }
+
+  // cubic Hermite basis and derivatives
+  inline void hermite(float t, float h[4], float dh[4]) {
+
+    const float t2 = t * t, t3 = t2 * t;
+    h[0]  =  2 * t3 - 3 * t2 + 1;   // value at 0
+    h[1]  =      t3 - 2 * t2 + t;   // slope at 0
+    h[2]  = -2 * t3 + 3 * t2;       // value at 1
+    h[3]  =      t3 -     t2;       // slope at 1
+    dh[0] =  6 * t2 - 6 * t;
+    dh[1] =  3 * t2 - 4 * t + 1;
+    dh[2] = -6 * t2 + 6 * t;
+    dh[3] =  3 * t2 - 2 * t;
+  }
+
+}
+
+
+HeightField::HeightField()
+  : _resolution{0}, _x0{0}, _y0{0}, _dx{1}, _dy{1}, _normal_sign{1},
+    _max_height_error{0}, _max_normal_error{0} {}
+
+bool HeightField::build(GMlib::PSurf<float,3>& surface, int resolution) {
+
+  _nodes.clear();
+  _resolution = 0;
+  if( resolution < 1 )
+    return false;
+
+  // xy box from the boundary curves of the surface
+  const float u0 = surface.getParStartU(), du = surface.getParDeltaU();
+  const float v0 = surface.getParStartV(), dv = surface.getParDeltaV();
+  float lo[2] = {  1e30f,  1e30f };
+  float hi[2] = { -1e30f, -1e30f };
+  const int edge_samples = 4 * resolution;
+  for( int k = 0; k <= edge_samples; ++k ) {
+
+    const float t = float(k) / edge_samples;
+    const float params[4][2] = { {u0 + t * du, v0}, {u0 + t * du, v0 + dv}, {u0, v0 + t * dv}, {u0 + du, v0 + t * dv} };
+    for( const auto& uv : params ) {
+      const GMlib::Point<float,3> p = surface.evaluate(uv[0], uv[1], 0, 0)[0][0];
+      for( int c = 0; c < 2; ++c ) {
+        lo[c] = std::min(lo[c], p(c));
+        hi[c] = std::max(hi[c], p(c));
+      }
+    }
+  }
+
+  const int n = resolution + 1;
+  _x0 = lo[0];
+  _y0 = lo[1];
+  _dx = (hi[0] - lo[0]) / resolution;
+  _dy = (hi[1] - lo[1]) / resolution;
+  if( _dx <= 0.0f || _dy <= 0.0f )
+    return false;
+
+  const float tolerance = 1e-5f * std::max(hi[0] - lo[0], hi[1] - lo[1]);
+  _resolution = resolution;
+  _nodes.resize(n * n);
+
+  // exact heights and slopes at the nodes, each row warm started from the one before
+  float row_u = u0 + 0.5f * du, row_v = v0 + 0.5f * dv;
+  for( int j = 0; j < n; ++j ) {
+
+    float u = row_u, v = row_v;
+    for( int i = 0; i < n; ++i ) {
+
+      GMlib::Point<float,3> p;
+      GMlib::Vector<float,3> nrm;
+      if( !solveXY(surface, _x0 + i * _dx, _y0 + j * _dy, u, v, p, nrm, tolerance) || std::abs(nrm(2)) < 1e-4f ) {
+        _nodes.clear();
+        _resolution = 0;
+        return false;
+      }
+      if( i == 0 && j == 0 )
+        _normal_sign = nrm(2) < 0.0f ? -1.0f : 1.0f;
+      if( i == 0 ) {
+        row_u = u;
+        row_v = v;
+      }
+
+      Node& nd = node(i, j);
+      nd.z  = p(2);
+      nd.zx = -nrm(0) / nrm(2);
+      nd.zy = -nrm(1) / nrm(2);
+      nd.u  = u;
+      nd.v  = v;
+    }
+  }
+
+  // cross derivatives from the neighbouring slopes
+  for( int j = 0; j < n; ++j )
+    for( int i = 0; i < n; ++i ) {
+      const int ja = std::max(0, j - 1), jb = std::min(resolution, j + 1);
+      node(i, j).zxy = (node(i, jb).zx - node(i, ja).zx) / ((jb - ja) * _dy);
+    }
+
+  // measure the interpolation against the surface between the nodes. Heights are worst
+  // at the middle of a cell, where the slopes of a Hermite patch are unusually exact,
+  // so the slopes are measured a quarter of a cell away from the nodes
+  _max_height_error = 0.0f;
+  _max_normal_error = 0.0f;
+  const float offsets[5][2] = { {0.5f, 0.0f}, {0.0f, 0.5f}, {0.5f, 0.5f}, {0.25f, 0.25f}, {0.75f, 0.75f} };
+  for( int j = 0; j < resolution; ++j )
+    for( int i = 0; i < resolution; ++i )
+      for( const auto& o : offsets ) {
+
+        const float x = _x0 + (i + o[0]) * _dx;
+        const float y = _y0 + (j + o[1]) * _dy;
+        float z, zx, zy, u, v;
+        lookup(x, y, z, zx, zy, u, v);
+
+        GMlib::Point<float,3> p;
+        GMlib::Vector<float,3> nrm;
+        if( !solveXY(surface, x, y, u, v, p, nrm, tolerance) )
+          continue;
+
+        // angle from sine and cosine, acos alone loses the small angles in float
+        const GMlib::Vector<float,3> nf = normal(zx, zy);
+        const float angle = std::atan2((nf ^ nrm).getLength(), nf * nrm);
+        _max_height_error = std::max(_max_height_error, std::abs(z - p(2)));
+        _max_normal_error = std::max(_max_normal_error, angle);
+      }
+
+  return true;
+}
+
+bool HeightField::isBuilt() const {
+
+  return _resolution > 0;
+}
+
+int HeightField::getResolution() const {
+
+  return _resolution;
+}
+
+float HeightField::getMaxHeightError() const {
+
+  return _max_height_error;
+}
+
+float HeightField::getMaxNormalError() const {
+
+  return _max_normal_error;
+}
+
+GMlib::Vector<float,3> HeightField::normal(float zx, float zy) const {
+
+  return GMlib::UnitVector<float,3>(GMlib::Vector<float,3>(-zx, -zy, 1.0f) * _normal_sign);
+}
+
+void HeightField::lookup(float x, float y, float& z, float& zx, float& zy, float& u, float& v) const {
+
+  const float fx = std::min(float(_resolution), std::max(0.0f, (x - _x0) / _dx));
+  const float fy = std::min(float(_resolution), std::max(0.0f, (y - _y0) / _dy));
+  const int   i  = std::min(_resolution - 1, int(fx));
+  const int   j  = std::min(_resolution - 1, int(fy));
+  const float t  = fx - i;
+  const float s  = fy - j;
+
+  float ht[4], dht[4], hs[4], dhs[4];
+  hermite(t, ht, dht);
+  hermite(s, hs, dhs);
+
+  z = zx = zy = 0.0f;
+  for( int b = 0; b < 2; ++b )
+    for( int a = 0; a < 2; ++a ) {
+
+      const Node& nd = node(i + a, j + b);
+      const float f[4] = { nd.z, nd.zx * _dx, nd.zy * _dy, nd.zxy * _dx * _dy };   // in cell units
+
+      const float bt[2]  = { ht[2 * a],  ht[2 * a + 1] };
+      const float dbt[2] = { dht[2 * a], dht[2 * a + 1] };
+      const float bs[2]  = { hs[2 * b],  hs[2 * b + 1] };
+      const float dbs[2] = { dhs[2 * b], dhs[2 * b + 1] };
+
+      z  += f[0] * bt[0]  * bs[0]  + f[1] * bt[1]  * bs[0]  + f[2] * bt[0]  * bs[1]  + f[3] * bt[1]  * bs[1];
+      zx += f[0] * dbt[0] * bs[0]  + f[1] * dbt[1] * bs[0]  + f[2] * dbt[0] * bs[1]  + f[3] * dbt[1] * bs[1];
+      zy += f[0] * bt[0]  * dbs[0] + f[1] * bt[1]  * dbs[0] + f[2] * bt[0]  * dbs[1] + f[3] * bt[1]  * dbs[1];
+    }
+  zx /= _dx;
+  zy /= _dy;
+
+  // parameters only seed the exact search, bilinear is enough
+  const Node& n00 = node(i, j);
+  const Node& n10 = node(i + 1, j);
+  const Node& n01 = node(i, j + 1);
+  const Node& n11 = node(i + 1, j + 1);
+  u = (1 - s) * ((1 - t) * n00.u + t * n10.u) + s * ((1 - t) * n01.u + t * n11.u);
+  v = (1 - s) * ((1 - t) * n00.v + t * n10.v) + s * ((1 - t) * n01.v + t * n11.v);
+}
+
+void HeightField::project(const GMlib::Point<float,3>& p, SurfaceSample& sample) const {
+
+  float z, zx, zy, u, v;
+  lookup(p(0), p(1), z, zx, zy, u, v);
+
+  // step from p along the normal below it, then look up again at the foot
+  const GMlib::Vector<float,3> n0 = normal(zx, zy);
+  const GMlib::Point<float,3>  q  = p - ((p - GMlib::Point<float,3>(p(0), p(1), z)) * n0) * n0;
+  lookup(q(0), q(1), z, zx, zy, u, v);
+
+  sample.point  = GMlib::Point<float,3>(q(0), q(1), z);
+  sample.normal = normal(zx, zy);
+  sample.u = u;
+  sample.v = v;
+}
@@ -0,0 +1,51 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include "surfaceprojector.h"
+
+// stl
+#include <vector>
+
+
+// Surface sampled as heights z(x,y) on a regular grid with the exact slopes
+// from the surface normals, interpolated with bicubic Hermite patches.
+// Lookups never evaluate the surface, so they are O(1) and thread safe.
+// Only surfaces that are graphs over their xy bounding box can be sampled.
+class HeightField {
+public:
+  HeightField();
+
+  // false if the surface does not cover its xy box as a height field
+  bool          build( GMlib::PSurf<float,3>& surface, int resolution );
+  bool          isBuilt() const;
+  int           getResolution() const;
+
+  // largest differences to the surface, measured between the grid nodes when building
+  float         getMaxHeightError() const;
+  float         getMaxNormalError() const;   // radians
+
+  // approximate closest point, from one vertical lookup and one along the normal
+  void          project( const GMlib::Point<float,3>& p, SurfaceSample& sample ) const;
+
+private:
+  struct Node {
+    float       z, zx, zy, zxy;
+    float       u, v;                       // surface parameters, warm start for exact refinement
+  };
+
+  int                   _resolution;        // cells along each axis
+  float                 _x0, _y0, _dx, _dy;
+  float                 _normal_sign;       // matches the orientation of the surface normal
+  std::vector<Node>     _nodes;
+  float                 _max_height_error;
+  float                 _max_normal_error;
+
+  const Node&   node( int i, int j ) const { return _nodes[j * (_resolution + 1) + i]; }
+  Node&         node( int i, int j )       { return _nodes[j * (_resolution + 1) + i]; }
+
+  void          lookup( float x, float y, float& z, float& zx, float& zy, float& u, float& v ) const;
+  GMlib::Vector<float,3>  normal( float zx, float zy ) const;
+
+}; // END class HeightField
+
+#endif // HEIGHTFIELD_H
@@ -0,0 +1,59 @@
+#include "perfcounter.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// stl
+#include <cstring>
+#endif
+
+
+namespace {
+
+  int counter = -1;
+
+}
+
+bool PerfCounter::start() {
+
+#ifdef __linux__
+  if( counter < 0 ) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;   // allowed without privileges
+    attr.exclude_hv     = 1;
+    counter = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    if( counter < 0 )
+      return false;
+  }
+
+  ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+  ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+  return true;
+#else
+  return false;
+#endif
+}
+
+long long PerfCounter::stop() {
+
+#ifdef __linux__
+  if( counter < 0 )
+    return -1;
+
+  ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+  long long misses = 0;
+  if( read(counter, &misses, sizeof(misses)) != sizeof(misses) )
+    return -1;
+  return misses;
+#else
+  return -1;
+#endif
+}
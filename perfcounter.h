@@ -0,0 +1,14 @@
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+
+// Hardware cache misses of the calling thread, for BallSimHeadless. Read through
+// Linux perf events; elsewhere, or when the kernel or cpu does not offer the
+// counter, start() returns false and stop() -1.
+namespace PerfCounter {
+
+  bool      start();
+  long long stop();   // cache misses since start()
+
+} // END namespace PerfCounter
+
+#endif // PERFCOUNTER_H
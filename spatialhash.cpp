@@ -0,0 +1,203 @@
+#include "spatialhash.h"
+
+// stl
+#include <cmath>
+#include <algorithm>
+
+
+SpatialHash::SpatialHash(float cell_size) : _cell_size{cell_size} {}
+
+void SpatialHash::setCellSize(float cell_size) {
+
+  if( cell_size > 0.0f )
+    _cell_size = cell_size;
+}
+
+float SpatialHash::getCellSize() const {
+
+  return _cell_size;
+}
+
+int SpatialHash::cellOf(float x) const {
+
+  return int(std::floor(x / _cell_size));
+}
+
+void SpatialHash::cellRange(const Aabb& box, int lo[3], int hi[3]) const {
+
+  for( int k = 0; k < 3; ++k ) {
+    lo[k] = cellOf(box.lo(k));
+    hi[k] = cellOf(box.hi(k));
+  }
+}
+
+unsigned int SpatialHash::hash(int cx, int cy, int cz) const {
+
+  const unsigned int h = (unsigned(cx) * 73856093u) ^ (unsigned(cy) * 19349663u) ^ (unsigned(cz) * 83492791u);
+  return h & unsigned(_bucket_start.size() - 2);
+}
+
+// a pair sharing several cells is only reported from the cell holding the
+// lower corner of the boxes' intersection
+bool SpatialHash::isHomeCell(const Aabb& a, const Aabb& b, const int cell[3]) const {
+
+  for( int k = 0; k < 3; ++k )
+    if( cellOf(std::max(a.lo(k), b.lo(k))) != cell[k] )
+      return false;
+  return true;
+}
+
+void SpatialHash::build(const std::vector<Aabb>& boxes) {
+
+  const int n = int(boxes.size());
+
+  _boxes = boxes;
+  _oversize.clear();
+  _dirty.clear();
+  _dirty.reserve(n); //a box is listed once, so update() never grows it
+  _is_dirty.assign(n, 0);
+  _is_oversize.assign(n, 0);
+  _stamp.resize(n, 0);
+
+  // 1) count the cells covered by each box
+  int lo[3], hi[3];
+  int total = 0;
+  for( int i = 0; i < n; ++i ) {
+
+    cellRange(_boxes[i], lo, hi);
+    const long cells = long(hi[0]-lo[0]+1) * long(hi[1]-lo[1]+1) * long(hi[2]-lo[2]+1);
+    if( cells > _max_cells_per_box ) {
+      _oversize.push_back(i);
+      _is_oversize[i] = 1;
+    }
+    else
+      total += int(cells);
+  }
+
+  size_t table = 64;
+  while( table < size_t(2 * total) )
+    table <<= 1;
+  _bucket_start.assign(table + 1, 0);
+
+  // 2) counting sort of the entries into the hash buckets
+  for( int i = 0; i < n; ++i ) {
+
+    if( _is_oversize[i] ) continue;
+    cellRange(_boxes[i], lo, hi);
+    for( int x = lo[0]; x <= hi[0]; ++x )
+      for( int y = lo[1]; y <= hi[1]; ++y )
+        for( int z = lo[2]; z <= hi[2]; ++z )
+          _bucket_start[hash(x,y,z) + 1]++;
+  }
+
+  for( size_t b = 1; b < _bucket_start.size(); ++b )
+    _bucket_start[b] += _bucket_start[b-1];
+
+  _bucket_fill.assign(_bucket_start.begin(), _bucket_start.end());
+  _entries.resize(total);
+
+  for( int i = 0; i < n; ++i ) {
+
+    if( _is_oversize[i] ) continue;
+    cellRange(_boxes[i], lo, hi);
+    for( int x = lo[0]; x <= hi[0]; ++x )
+      for( int y = lo[1]; y <= hi[1]; ++y )
+        for( int z = lo[2]; z <= hi[2]; ++z ) {
+          Entry& e = _entries[_bucket_fill[hash(x,y,z)]++];
+          e.id = i;
+          e.cell[0] = x; e.cell[1] = y; e.cell[2] = z;
+        }
+  }
+}
+
+void SpatialHash::update(int id, const Aabb& box) {
+
+  _boxes[id] = box;
+  if( !_is_dirty[id] ) {
+    _is_dirty[id] = 1;
+    _dirty.push_back(id);
+  }
+}
+
+void SpatialHash::findPairs(std::vector<std::pair<int,int>>& pairs) const {
+
+  pairs.clear();
+
+  for( size_t b = 0; b + 1 < _bucket_start.size(); ++b ) {
+
+    for( int a = _bucket_start[b]; a < _bucket_start[b+1]; ++a ) {
+      const Entry& ea = _entries[a];
+
+      for( int c = a + 1; c < _bucket_start[b+1]; ++c ) {
+        const Entry& ec = _entries[c];
+
+        // different cells may share a bucket
+        if( ea.id == ec.id || ea.cell[0] != ec.cell[0] || ea.cell[1] != ec.cell[1] || ea.cell[2] != ec.cell[2] )
+          continue;
+
+        const Aabb& ba = _boxes[ea.id];
+        const Aabb& bc = _boxes[ec.id];
+        if( ba.overlaps(bc) && isHomeCell(ba, bc, ea.cell) )
+          pairs.emplace_back(std::min(ea.id, ec.id), std::max(ea.id, ec.id));
+      }
+    }
+  }
+
+  for( size_t k = 0; k < _oversize.size(); ++k ) {
+
+    const int o = _oversize[k];
+    for( int j = 0; j < int(_boxes.size()); ++j ) {
+
+      // pairs of two oversized boxes are reported once
+      if( j == o || (j < o && _is_oversize[j]) )
+        continue;
+      if( _boxes[o].overlaps(_boxes[j]) )
+        pairs.emplace_back(std::min(o, j), std::max(o, j));
+    }
+  }
+}
+
+void SpatialHash::query(int id, std::vector<int>& result) {
+
+  result.clear();
+
+  const int stamp = ++_query_stamp;
+  _stamp[id] = stamp;
+
+  const Aabb& box = _boxes[id];
+
+  auto test = [&](int j) {
+    if( _stamp[j] != stamp && box.overlaps(_boxes[j]) ) {
+      _stamp[j] = stamp;
+      result.push_back(j);
+    }
+  };
+
+  int lo[3], hi[3];
+  cellRange(box, lo, hi);
+  const long cells = long(hi[0]-lo[0]+1) * long(hi[1]-lo[1]+1) * long(hi[2]-lo[2]+1);
+
+  if( cells > _max_cells_per_box ) {
+    for( int j = 0; j < int(_boxes.size()); ++j )
+      test(j);
+    return;
+  }
+
+  for( int x = lo[0]; x <= hi[0]; ++x )
+    for( int y = lo[1]; y <= hi[1]; ++y )
+      for( int z = lo[2]; z <= hi[2]; ++z ) {
+
+        const unsigned int b = hash(x,y,z);
+        for( int e = _bucket_start[b]; e < _bucket_start[b+1]; ++e ) {
+          const Entry& entry = _entries[e];
+          if( entry.cell[0] == x && entry.cell[1] == y && entry.cell[2] == z )
+            test(entry.id);
+        }
+      }
+
+  // boxes not (or no longer) matching their cells
+  for( size_t k = 0; k < _oversize.size(); ++k )
+    test(_oversize[k]);
+  for( size_t k = 0; k < _dirty.size(); ++k )
+    test(_dirty[k]);
+}
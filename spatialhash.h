@@ -0,0 +1,50 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include "broadphase.h"
+
+
+// Uniform grid broad phase. Every box is registered in all the cells it covers,
+// the cells are hashed into a table which is rebuilt (counting sort) each frame.
+// Boxes covering too many cells are kept in a separate list and tested against all.
+class SpatialHash : public BroadPhase {
+public:
+  explicit SpatialHash( float cell_size = 4.0f );
+
+  void                  setCellSize( float cell_size );
+  float                 getCellSize() const;
+
+  void                  build( const std::vector<Aabb>& boxes ) override;
+  void                  update( int id, const Aabb& box ) override;
+
+  void                  findPairs( std::vector<std::pair<int,int>>& pairs ) const override;
+  void                  query( int id, std::vector<int>& result ) override;
+
+private:
+  struct Entry {
+    int                 id;
+    int                 cell[3];
+  };
+
+  float                 _cell_size;
+  int                   _max_cells_per_box {64};
+
+  std::vector<Aabb>     _boxes;
+  std::vector<int>      _bucket_start;
+  std::vector<int>      _bucket_fill;
+  std::vector<Entry>    _entries;
+  std::vector<int>      _oversize;
+  std::vector<int>      _dirty;
+  std::vector<char>     _is_dirty;
+  std::vector<char>     _is_oversize;
+  std::vector<int>      _stamp;
+  int                   _query_stamp {0};
+
+  void                  cellRange( const Aabb& box, int lo[3], int hi[3] ) const;
+  int                   cellOf( float x ) const;
+  unsigned int          hash( int cx, int cy, int cz ) const;
+  bool                  isHomeCell( const Aabb& a, const Aabb& b, const int cell[3] ) const;
+
+}; // END class SpatialHash
+
+#endif // SPATIALHASH_H
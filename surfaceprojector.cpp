@@ -0,0 +1,194 @@
+#include "surfaceprojector.h"
+
+// stl
+#include <algorithm>
+#include <cmath>
+
+
+SurfaceProjector::SurfaceProjector(float tolerance, int max_iterations)
+  : _tolerance{tolerance}, _max_iterations{max_iterations} {}
+
+void SurfaceProjector::setTolerance(float tolerance) {
+
+  _tolerance = tolerance;
+}
+
+float SurfaceProjector::getTolerance() const {
+
+  return _tolerance;
+}
+
+void SurfaceProjector::setMaxIterations(int max_iterations) {
+
+  _max_iterations = std::max(0, max_iterations);
+}
+
+int SurfaceProjector::getMaxIterations() const {
+
+  return _max_iterations;
+}
+
+namespace {
+
+  // GMlib evaluation, the surface is written to so each thread needs its own
+  struct GeneralEval {
+    GMlib::PSurf<float,3>&  surface;
+
+    void operator()( float u, float v, SurfaceDerivatives& d ) {
+      const GMlib::DMatrix<GMlib::Vector<float,3>>& m = surface.evaluate(u, v, 2, 2);
+      d.s   = m[0][0];
+      d.su  = m[1][0];
+      d.sv  = m[0][1];
+      d.suu = m[2][0];
+      d.suv = m[1][1];
+      d.svv = m[0][2];
+    }
+  };
+
+  struct TraitsEval {
+    const SurfaceTraits&    traits;
+
+    void operator()( float u, float v, SurfaceDerivatives& d ) {
+      traits.evaluate(u, v, d);
+    }
+  };
+
+}
+
+int SurfaceProjector::project(GMlib::PSurf<float,3>& surface, const GMlib::Point<float,3>& p,
+                              float& u, float& v, SurfaceSample& sample) const {
+
+  const float u0 = surface.getParStartU(), u1 = u0 + surface.getParDeltaU();
+  const float v0 = surface.getParStartV(), v1 = v0 + surface.getParDeltaV();
+
+  GeneralEval eval {surface};
+  return newton(eval, u0, u1, v0, v1, p, u, v, sample);
+}
+
+int SurfaceProjector::project(const SurfaceTraits& traits, const GMlib::Point<float,3>& p,
+                              float& u, float& v, SurfaceSample& sample) const {
+
+  if( traits.getKind() == SurfaceKind::Planar ) {
+
+    SurfaceDerivatives d;
+    traits.closestOnPlane(p, u, v);
+    traits.evaluate(u, v, d);
+    sample.point  = d.s;
+    sample.normal = GMlib::UnitVector<float,3>(d.sv ^ d.su);
+    sample.u = u;
+    sample.v = v;
+    return 0;
+  }
+
+  TraitsEval eval {traits};
+  return newton(eval, traits.getStartU(), traits.getEndU(), traits.getStartV(), traits.getEndV(), p, u, v, sample);
+}
+
+int SurfaceProjector::project(const SurfaceTraits& traits, int count, const GMlib::Point<float,3>* p,
+                              float* u, float* v, SurfaceSample* samples, ProjectionBatch& batch) const {
+
+  if( traits.getKind() != SurfaceKind::Bezier ) {
+
+    // nothing to share between the points of the cheap kinds
+    int iterations = 0;
+    for( int k = 0; k < count; ++k )
+      iterations += project(traits, p[k], u[k], v[k], samples[k]);
+    return iterations;
+  }
+
+  const float u0 = traits.getStartU(), u1 = traits.getEndU();
+  const float v0 = traits.getStartV(), v1 = traits.getEndV();
+
+  batch.active.resize(count);
+  for( int k = 0; k < count; ++k )
+    batch.active[k] = k;
+
+  int iterations = 0;
+  for( int round = 0; !batch.active.empty(); ++round ) {
+
+    const int n = int(batch.active.size());
+    batch.u.resize(n);
+    batch.v.resize(n);
+    batch.d.resize(n);
+    for( int a = 0; a < n; ++a ) {
+      batch.u[a] = u[batch.active[a]];
+      batch.v[a] = v[batch.active[a]];
+    }
+    traits.evaluate(n, batch.u.data(), batch.v.data(), batch.d.data());
+
+    // the same steps as newton(), the points that go on are packed to the front
+    int next = 0;
+    for( int a = 0; a < n; ++a ) {
+
+      const int k = batch.active[a];
+      const SurfaceDerivatives& m = batch.d[a];
+      samples[k].point  = m.s;
+      samples[k].normal = GMlib::UnitVector<float,3>(m.sv ^ m.su);
+      samples[k].u = u[k];
+      samples[k].v = v[k];
+
+      if( round >= _max_iterations || !newtonStep(m, p[k], u0, u1, v0, v1, u[k], v[k]) )
+        continue;
+
+      ++iterations;
+      batch.active[next++] = k;
+    }
+    batch.active.resize(next);
+  }
+
+  return iterations;
+}
+
+// one step towards the minimum of |S(u,v) - p|^2, false when converged or stuck, u and v then stay
+bool SurfaceProjector::newtonStep(const SurfaceDerivatives& m, const GMlib::Point<float,3>& p,
+                                  float u0, float u1, float v0, float v1, float& u, float& v) const {
+
+  // Newton with Gauss-Newton as fallback away from a minimum
+  const GMlib::Vector<float,3> d = m.s - p;
+  const double gu = m.su * d;
+  const double gv = m.sv * d;
+  double huu = m.su * m.su + m.suu * d;
+  double hvv = m.sv * m.sv + m.svv * d;
+  double huv = m.su * m.sv + m.suv * d;
+  double det = huu * hvv - huv * huv;
+  if( det <= 0.0 || huu <= 0.0 ) {
+    huu = m.su * m.su;
+    hvv = m.sv * m.sv;
+    huv = m.su * m.sv;
+    det = huu * hvv - huv * huv;
+  }
+  if( det <= 1e-20 )
+    return false;
+
+  const float nu = std::min(u1, std::max(u0, float(u - (hvv * gu - huv * gv) / det)));
+  const float nv = std::min(v1, std::max(v0, float(v - (huu * gv - huv * gu) / det)));
+  if( std::abs(nu - u) + std::abs(nv - v) < _tolerance )
+    return false;
+
+  u = nu;
+  v = nv;
+  return true;
+}
+
+template <typename Eval>
+int SurfaceProjector::newton(Eval& eval, float u0, float u1, float v0, float v1,
+                             const GMlib::Point<float,3>& p, float& u, float& v, SurfaceSample& sample) const {
+
+  SurfaceDerivatives m;
+  int iterations = 0;
+  while( true ) {
+
+    eval(u, v, m);
+    sample.point  = m.s;
+    sample.normal = GMlib::UnitVector<float,3>(m.sv ^ m.su);
+    sample.u = u;
+    sample.v = v;
+
+    if( iterations >= _max_iterations || !newtonStep(m, p, u0, u1, v0, v1, u, v) )
+      break;
+
+    ++iterations;
+  }
+
+  return iterations;
+}
@@ -0,0 +1,64 @@
+#ifndef SURFACEPROJECTOR_H
+#define SURFACEPROJECTOR_H
+
+#include <gmParametricsModule>
+
+#include "surfacetraits.h"
+
+// stl
+#include <vector>
+
+
+// Closest point on a surface together with what the balls need from it
+struct SurfaceSample {
+  GMlib::Point<float,3>     point;
+  GMlib::Vector<float,3>    normal;
+  float                     u;
+  float                     v;
+};
+
+// Scratch space of a batched search, kept between calls so they do not allocate
+struct ProjectionBatch {
+  std::vector<int>                  active;     // points still searching
+  std::vector<float>                u, v;       // their parameters, packed
+  std::vector<SurfaceDerivatives>   d;
+};
+
+// Newton search for the closest surface point, started from the parameters of
+// the last search. Each iteration is one evaluate(u,v,2,2), the point and normal
+// of the result come from the last evaluation, so no extra evaluate is needed.
+// Surfaces with known SurfaceTraits are evaluated inline, planes in closed form.
+class SurfaceProjector {
+public:
+  explicit SurfaceProjector( float tolerance = 1e-5f, int max_iterations = 8 );
+
+  void          setTolerance( float tolerance );
+  float         getTolerance() const;
+  void          setMaxIterations( int max_iterations );
+  int           getMaxIterations() const;
+
+  // returns the number of Newton steps taken, u and v are updated in place
+  int           project( GMlib::PSurf<float,3>& surface, const GMlib::Point<float,3>& p,
+                         float& u, float& v, SurfaceSample& sample ) const;
+  int           project( const SurfaceTraits& traits, const GMlib::Point<float,3>& p,
+                         float& u, float& v, SurfaceSample& sample ) const;
+
+  // count points at once, each Newton round evaluates all points still searching in
+  // one batch. Gives the result of project() for each point, returns the total steps
+  int           project( const SurfaceTraits& traits, int count, const GMlib::Point<float,3>* p,
+                         float* u, float* v, SurfaceSample* samples, ProjectionBatch& batch ) const;
+
+private:
+  float         _tolerance;       // parameter step that counts as converged
+  int           _max_iterations;
+
+  bool          newtonStep( const SurfaceDerivatives& m, const GMlib::Point<float,3>& p,
+                            float u0, float u1, float v0, float v1, float& u, float& v ) const;
+
+  template <typename Eval>
+  int           newton( Eval& eval, float u0, float u1, float v0, float v1,
+                        const GMlib::Point<float,3>& p, float& u, float& v, SurfaceSample& sample ) const;
+
+}; // END class SurfaceProjector
+
+#endif // SURFACEPROJECTOR_H
@@ -0,0 +1,283 @@
+#include "surfacetraits.h"
+
+#include "bernstein.h"
+
+#include "gmpbiplane.h"
+#include "gmpcurplane.h"
+
+// stl
+#include <algorithm>
+
+
+namespace {
+
+  // one value for each of W points, plain loops over the lanes which the compiler
+  // vectorizes. The arithmetic is that of float, lane by lane, so Bernstein::Basis
+  // on lanes gives bit for bit the scalar basis of each point
+  template <int W>
+  struct Lanes {
+    float   l[W];
+
+    Lanes() {}
+    Lanes( float x ) { for( int k = 0; k < W; ++k ) l[k] = x; }
+  };
+
+  template <int W>
+  inline Lanes<W> operator+( const Lanes<W>& a, const Lanes<W>& b ) {
+    Lanes<W> r;
+    for( int k = 0; k < W; ++k ) r.l[k] = a.l[k] + b.l[k];
+    return r;
+  }
+
+  template <int W>
+  inline Lanes<W> operator-( const Lanes<W>& a, const Lanes<W>& b ) {
+    Lanes<W> r;
+    for( int k = 0; k < W; ++k ) r.l[k] = a.l[k] - b.l[k];
+    return r;
+  }
+
+  template <int W>
+  inline Lanes<W> operator*( const Lanes<W>& a, const Lanes<W>& b ) {
+    Lanes<W> r;
+    for( int k = 0; k < W; ++k ) r.l[k] = a.l[k] * b.l[k];
+    return r;
+  }
+
+  template <int W>
+  inline Lanes<W> operator-( const Lanes<W>& a ) {
+    Lanes<W> r;
+    for( int k = 0; k < W; ++k ) r.l[k] = -a.l[k];
+    return r;
+  }
+
+}
+
+SurfaceTraits::SurfaceTraits()
+  : _kind{SurfaceKind::General}, _u0{0}, _u1{1}, _v0{0}, _v1{1}, _degreeU{0}, _degreeV{0} {}
+
+SurfaceTraits SurfaceTraits::detect(GMlib::PSurf<float,3>& surface) {
+
+  SurfaceTraits traits;
+  traits._u0 = surface.getParStartU();
+  traits._u1 = traits._u0 + surface.getParDeltaU();
+  traits._v0 = surface.getParStartV();
+  traits._v1 = traits._v0 + surface.getParDeltaV();
+
+  if( dynamic_cast<GMlib::PPlane<float>*>(&surface) ) {
+
+    // affine, so the corner and the first derivatives say it all
+    const GMlib::DMatrix<GMlib::Vector<float,3>>& m = surface.evaluate(traits._u0, traits._v0, 1, 1);
+    traits._kind = SurfaceKind::Planar;
+    traits._b = m[1][0];
+    traits._c = m[0][1];
+    traits._e = GMlib::Vector<float,3>(0,0,0);
+    traits._a = m[0][0] - traits._u0 * traits._b - traits._v0 * traits._c;
+  }
+  else if( auto biplane = dynamic_cast<PBiPlane<float>*>(&surface) ) {
+
+    const GMlib::Point<float,3>& p1 = biplane->getCorner(0);
+    const GMlib::Point<float,3>& p2 = biplane->getCorner(1);
+    const GMlib::Point<float,3>& p3 = biplane->getCorner(2);
+    const GMlib::Point<float,3>& p4 = biplane->getCorner(3);
+    traits._kind = SurfaceKind::Bilinear;
+    traits._a = p1;
+    traits._b = p2 - p1;
+    traits._c = p4 - p1;
+    traits._e = p1 - p2 + p3 - p4;
+  }
+  else if( auto curplane = dynamic_cast<PCurPlane<float>*>(&surface) ) {
+
+    const GMlib::DMatrix<GMlib::Vector<float,3>>& net = curplane->getControlNet();
+    traits._kind = SurfaceKind::Biquadratic;
+    for( int i = 0; i < 3; ++i )
+      for( int j = 0; j < 3; ++j )
+        traits._net[i][j] = net[i][j];
+  }
+  else if( auto bezier = dynamic_cast<GMlib::PBezierSurf<float>*>(&surface) ) {
+
+    const GMlib::DMatrix<GMlib::Vector<float,3>>& net = bezier->getControlPoints();
+    const int nu = net.getDim1() - 1;
+    const int nv = net.getDim2() - 1;
+    if( nu >= 1 && nv >= 1 && nu <= MaxBezierDegree && nv <= MaxBezierDegree ) {
+
+      traits._kind = SurfaceKind::Bezier;
+      traits._degreeU = nu;
+      traits._degreeV = nv;
+      traits._bezier.reserve((nu + 1) * (nv + 1));
+      for( int i = 0; i <= nu; ++i )
+        for( int j = 0; j <= nv; ++j )
+          traits._bezier.push_back(net[i][j]);
+    }
+  }
+
+  return traits;
+}
+
+SurfaceKind SurfaceTraits::getKind() const {
+
+  return _kind;
+}
+
+bool SurfaceTraits::isAnalytic() const {
+
+  return _kind != SurfaceKind::General;
+}
+
+void SurfaceTraits::evaluate(float u, float v, SurfaceDerivatives& d) const {
+
+  if( _kind == SurfaceKind::Bezier ) {
+    evaluateBezier(u, v, d);
+    return;
+  }
+
+  if( _kind == SurfaceKind::Biquadratic ) {
+
+    Bernstein::Basis<float,2> bu, bv;
+    bu.evaluate(u);
+    bv.evaluate(v);
+
+    GMlib::Vector<float,3> s(0,0,0);
+    d.su = d.sv = d.suu = d.suv = d.svv = s;
+    for( int i = 0; i < 3; ++i )
+      for( int j = 0; j < 3; ++j ) {
+        const GMlib::Vector<float,3>& c = _net[i][j];
+        s     += (bu.d[0][i] * bv.d[0][j]) * c;
+        d.su  += (bu.d[1][i] * bv.d[0][j]) * c;
+        d.sv  += (bu.d[0][i] * bv.d[1][j]) * c;
+        d.suu += (bu.d[2][i] * bv.d[0][j]) * c;
+        d.suv += (bu.d[1][i] * bv.d[1][j]) * c;
+        d.svv += (bu.d[0][i] * bv.d[2][j]) * c;
+      }
+    d.s = s;
+    return;
+  }
+
+  // planar and bilinear
+  d.s   = _a + u * _b + v * _c + (u * v) * _e;
+  d.su  = _b + v * _e;
+  d.sv  = _c + u * _e;
+  d.suu = GMlib::Vector<float,3>(0,0,0);
+  d.svv = GMlib::Vector<float,3>(0,0,0);
+  d.suv = _e;
+}
+
+void SurfaceTraits::evaluateBezier(float u, float v, SurfaceDerivatives& d) const {
+
+  // the patch lives on [0,1]^2, so the derivatives scale with the domain
+  const float du = 1.0f / (_u1 - _u0);
+  const float dv = 1.0f / (_v1 - _v0);
+
+  Bernstein::Basis<float,MaxBezierDegree,2> bu, bv;
+  bu.evaluate((u - _u0) * du, 2, _degreeU);
+  bv.evaluate((v - _v0) * dv, 2, _degreeV);
+
+  GMlib::Vector<float,3> s(0,0,0);
+  d.su = d.sv = d.suu = d.suv = d.svv = s;
+  const GMlib::Vector<float,3>* c = _bezier.data();
+  for( int i = 0; i <= _degreeU; ++i ) {
+
+    // sum over v first, then weigh the three rows by the u basis
+    GMlib::Vector<float,3> r0(0,0,0), r1(0,0,0), r2(0,0,0);
+    for( int j = 0; j <= _degreeV; ++j, ++c ) {
+      r0 += bv.d[0][j] * (*c);
+      r1 += bv.d[1][j] * (*c);
+      r2 += bv.d[2][j] * (*c);
+    }
+    s     += bu.d[0][i] * r0;
+    d.su  += bu.d[1][i] * r0;
+    d.sv  += bu.d[0][i] * r1;
+    d.suu += bu.d[2][i] * r0;
+    d.suv += bu.d[1][i] * r1;
+    d.svv += bu.d[0][i] * r2;
+  }
+
+  d.s   = s;
+  d.su  *= du;
+  d.sv  *= dv;
+  d.suu *= du * du;
+  d.suv *= du * dv;
+  d.svv *= dv * dv;
+}
+
+void SurfaceTraits::evaluate(int count, const float* u, const float* v, SurfaceDerivatives* d) const {
+
+  int k = 0;
+  if( _kind == SurfaceKind::Bezier )
+    for( ; k + BatchLanes <= count; k += BatchLanes )
+      evaluateBezierLanes(u + k, v + k, d + k);
+
+  for( ; k < count; ++k )
+    evaluate(u[k], v[k], d[k]);
+}
+
+// evaluateBezier() for BatchLanes points, the same operations in the same order
+void SurfaceTraits::evaluateBezierLanes(const float* u, const float* v, SurfaceDerivatives* d) const {
+
+  typedef Lanes<BatchLanes> L;
+
+  const float du = 1.0f / (_u1 - _u0);
+  const float dv = 1.0f / (_v1 - _v0);
+
+  L tu, tv;
+  for( int l = 0; l < BatchLanes; ++l ) {
+    tu.l[l] = (u[l] - _u0) * du;
+    tv.l[l] = (v[l] - _v0) * dv;
+  }
+
+  Bernstein::Basis<L,MaxBezierDegree,2> bu, bv;
+  bu.evaluate(tu, 2, _degreeU);
+  bv.evaluate(tv, 2, _degreeV);
+
+  // per coordinate: s, su, sv, suu, suv, svv
+  L sum[6][3];
+  for( int a = 0; a < 6; ++a )
+    for( int k = 0; k < 3; ++k )
+      sum[a][k] = L(0.0f);
+
+  const GMlib::Vector<float,3>* c = _bezier.data();
+  for( int i = 0; i <= _degreeU; ++i ) {
+
+    L r[3][3];
+    for( int o = 0; o < 3; ++o )
+      for( int k = 0; k < 3; ++k )
+        r[o][k] = L(0.0f);
+
+    for( int j = 0; j <= _degreeV; ++j, ++c )
+      for( int o = 0; o < 3; ++o )
+        for( int k = 0; k < 3; ++k ) {
+          const float ck = (*c)(k);
+          for( int l = 0; l < BatchLanes; ++l )
+            r[o][k].l[l] += bv.d[o][j].l[l] * ck;
+        }
+
+    // s, su, sv, suu, suv, svv take the u order a and the v rows o below
+    static const int order[6] = {0, 1, 0, 2, 1, 0};
+    static const int row[6]   = {0, 0, 1, 0, 1, 2};
+    for( int a = 0; a < 6; ++a )
+      for( int k = 0; k < 3; ++k )
+        for( int l = 0; l < BatchLanes; ++l )
+          sum[a][k].l[l] += bu.d[order[a]][i].l[l] * r[row[a]][k].l[l];
+  }
+
+  const float scale[6] = {1.0f, du, dv, du * du, du * dv, dv * dv};
+  for( int l = 0; l < BatchLanes; ++l ) {
+    GMlib::Vector<float,3>* out[6] = {nullptr, &d[l].su, &d[l].sv, &d[l].suu, &d[l].suv, &d[l].svv};
+    for( int k = 0; k < 3; ++k ) {
+      d[l].s[k] = sum[0][k].l[l];
+      for( int a = 1; a < 6; ++a )
+        (*out[a])[k] = sum[a][k].l[l] * scale[a];
+    }
+  }
+}
+
+void SurfaceTraits::closestOnPlane(const GMlib::Point<float,3>& p, float& u, float& v) const {
+
+  // normal equations of a + u b + v c = p
+  const GMlib::Vector<float,3> d = p - _a;
+  const double bb = _b * _b, bc = _b * _c, cc = _c * _c;
+  const double db = d * _b,  dc = d * _c;
+  const double det = bb * cc - bc * bc;
+
+  u = std::min(_u1, std::max(_u0, float((cc * db - bc * dc) / det)));
+  v = std::min(_v1, std::max(_v0, float((bb * dc - bc * db) / det)));
+}
@@ -0,0 +1,67 @@
+#ifndef SURFACETRAITS_H
+#define SURFACETRAITS_H
+
+#include <gmParametricsModule>
+
+// stl
+#include <vector>
+
+
+enum class SurfaceKind { General, Planar, Bilinear, Biquadratic, Bezier };
+
+// Value and derivatives up to second order at one (u,v)
+struct SurfaceDerivatives {
+  GMlib::Point<float,3>     s;
+  GMlib::Vector<float,3>    su, sv;
+  GMlib::Vector<float,3>    suu, suv, svv;
+};
+
+// Closed-form description of a surface whose type is known (PPlane and PWall,
+// PBiPlane, PCurPlane, PBezierSurf up to MaxBezierDegree), captured once so it can
+// be evaluated inline without evaluate(), its DMatrix or its shared state. Other
+// surfaces are General and keep going through the iterative GMlib path.
+class SurfaceTraits {
+public:
+  static const int          MaxBezierDegree = 15;
+  static const int          BatchLanes = 8;      // points evaluated side by side in a batch
+
+  SurfaceTraits();
+
+  static SurfaceTraits      detect( GMlib::PSurf<float,3>& surface );
+
+  SurfaceKind               getKind() const;
+  bool                      isAnalytic() const;
+
+  float                     getStartU() const { return _u0; }
+  float                     getEndU() const   { return _u1; }
+  float                     getStartV() const { return _v0; }
+  float                     getEndV() const   { return _v1; }
+
+  void                      evaluate( float u, float v, SurfaceDerivatives& d ) const;
+
+  // count points at once, a Bezier floor BatchLanes points per pass with the basis of
+  // all of them in one table, the results are those of evaluate() for each point
+  void                      evaluate( int count, const float* u, const float* v, SurfaceDerivatives* d ) const;
+
+  // planes only: closest point, clamped to the parameter domain
+  void                      closestOnPlane( const GMlib::Point<float,3>& p, float& u, float& v ) const;
+
+private:
+  SurfaceKind               _kind;
+  float                     _u0, _u1, _v0, _v1;
+
+  // planar and bilinear: S = a + u b + v c + uv e, biquadratic: 3x3 Bernstein net
+  GMlib::Point<float,3>     _a;
+  GMlib::Vector<float,3>    _b, _c, _e;
+  GMlib::Vector<float,3>    _net[3][3];
+
+  // bezier: row major (degree u + 1) x (degree v + 1) net on the domain above
+  int                       _degreeU, _degreeV;
+  std::vector<GMlib::Vector<float,3>>   _bezier;
+
+  void                      evaluateBezier( float u, float v, SurfaceDerivatives& d ) const;
+  void                      evaluateBezierLanes( const float* u, const float* v, SurfaceDerivatives* d ) const;
+
+}; // END class SurfaceTraits
+
+#endif // SURFACETRAITS_H
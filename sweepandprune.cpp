@@ -0,0 +1,203 @@
+#include "sweepandprune.h"
+
+// stl
+#include <algorithm>
+
+
+int SweepAndPrune::getAxis() const {
+
+  return _axis;
+}
+
+long SweepAndPrune::getSwapCount() const {
+
+  return _swaps;
+}
+
+// axis with the largest variance of the box centers, kept unless another one is clearly better
+int SweepAndPrune::chooseAxis() const {
+
+  const int n = int(_boxes.size());
+  if( n < 2 ) return _axis;
+
+  double sum[3] = {0,0,0}, sum2[3] = {0,0,0};
+  for( int i = 0; i < n; ++i )
+    for( int k = 0; k < 3; ++k ) {
+      const double c = 0.5 * (_boxes[i].lo(k) + _boxes[i].hi(k));
+      sum[k] += c;
+      sum2[k] += c * c;
+    }
+
+  double var[3];
+  for( int k = 0; k < 3; ++k )
+    var[k] = sum2[k] / n - (sum[k] / n) * (sum[k] / n);
+
+  int best = _axis;
+  for( int k = 0; k < 3; ++k )
+    if( var[k] > 2.0 * var[best] )
+      best = k;
+  return best;
+}
+
+// k moves left or right to its place in the sorted order
+void SweepAndPrune::moveToPlace(int k) {
+
+  const int   id  = _order[k];
+  const float key = _keys[k];
+
+  while( k > 0 && _keys[k-1] > key ) {
+    _order[k] = _order[k-1];
+    _keys[k]  = _keys[k-1];
+    _rank[_order[k]] = k;
+    --k;
+    ++_swaps;
+  }
+  while( k + 1 < int(_order.size()) && _keys[k+1] < key ) {
+    _order[k] = _order[k+1];
+    _keys[k]  = _keys[k+1];
+    _rank[_order[k]] = k;
+    ++k;
+    ++_swaps;
+  }
+
+  _order[k] = id;
+  _keys[k]  = key;
+  _rank[id] = k;
+}
+
+// insertion sort, close to linear when the order of the last frame still nearly holds
+void SweepAndPrune::resort() {
+
+  for( int k = 0; k < int(_order.size()); ++k )
+    _keys[k] = _boxes[_order[k]].lo(_axis);
+
+  for( int k = 1; k < int(_order.size()); ++k )
+    if( _keys[k] < _keys[k-1] )
+      moveToPlace(k);
+}
+
+void SweepAndPrune::build(const std::vector<Aabb>& boxes) {
+
+  const int n = int(boxes.size());
+  _boxes = boxes;
+  _swaps = 0;
+
+  // a new axis or many new boxes invalidate the order of the last frame, start over with a full sort
+  const int axis = chooseAxis();
+  const int kept = int(_order.size());
+  if( kept > n || n - kept > kept / 8 || axis != _axis ) {
+
+    _axis = axis;
+    _order.resize(n);
+    _keys.resize(n);
+    _rank.resize(n);
+    for( int i = 0; i < n; ++i )
+      _order[i] = i;
+    std::sort(_order.begin(), _order.end(),
+              [this](int a, int b) { return _boxes[a].lo(_axis) < _boxes[b].lo(_axis); });
+    for( int k = 0; k < n; ++k )
+      _rank[_order[k]] = k;
+  }
+  else {
+
+    // the few boxes added since the last frame start at the end, the insertion sort places them
+    _order.resize(n);
+    _keys.resize(n);
+    _rank.resize(n);
+    for( int i = kept; i < n; ++i ) {
+      _order[i] = i;
+      _rank[i]  = i;
+    }
+  }
+
+  resort();
+
+  _maxExtent = 0.0f;
+  for( int i = 0; i < n; ++i )
+    _maxExtent = std::max(_maxExtent, _boxes[i].hi(_axis) - _boxes[i].lo(_axis));
+}
+
+// the next build sorts from scratch
+void SweepAndPrune::reset() {
+
+  _order.clear();
+}
+
+void SweepAndPrune::remove(int id, int last) {
+
+  const int n = int(_order.size());
+  if( id >= n )
+    return;
+
+  // a box added since the last build takes the place of id, only its key changes with the next build
+  if( last >= n )
+    return;
+  if( last != n - 1 ) {   // removes were missed, the ids no longer match
+    reset();
+    return;
+  }
+
+  // last is the last box of the build, the entry of id leaves the order and last takes its id
+  const int k = _rank[id];
+  _order.erase(_order.begin() + k);
+  _keys.erase(_keys.begin() + k);
+  for( int j = k; j < n - 1; ++j )
+    _rank[_order[j]] = j;
+
+  if( last != id ) {
+    _order[_rank[last]] = id;
+    _rank[id]  = _rank[last];
+    _boxes[id] = _boxes[last];
+  }
+  _rank.pop_back();
+  _boxes.pop_back();
+}
+
+void SweepAndPrune::update(int id, const Aabb& box) {
+
+  _boxes[id] = box;
+  _maxExtent = std::max(_maxExtent, box.hi(_axis) - box.lo(_axis));
+
+  const int k = _rank[id];
+  _keys[k] = box.lo(_axis);
+  moveToPlace(k);
+}
+
+void SweepAndPrune::findPairs(std::vector<std::pair<int,int>>& pairs) const {
+
+  pairs.clear();
+
+  const int n = int(_order.size());
+  for( int a = 0; a < n; ++a ) {
+
+    const int   ia = _order[a];
+    const Aabb& ba = _boxes[ia];
+    const float hi = ba.hi(_axis);
+
+    // every box starting before ba ends overlaps it along the axis
+    for( int b = a + 1; b < n && _keys[b] <= hi; ++b ) {
+      const int ib = _order[b];
+      if( ba.overlaps(_boxes[ib]) )
+        pairs.emplace_back(std::min(ia, ib), std::max(ia, ib));
+    }
+  }
+}
+
+void SweepAndPrune::query(int id, std::vector<int>& result) {
+
+  result.clear();
+
+  const Aabb& box = _boxes[id];
+  const int   k   = _rank[id];
+  const int   n   = int(_order.size());
+
+  // boxes to the left start earlier, but none is longer than _maxExtent
+  const float reach = box.lo(_axis) - _maxExtent;
+  for( int j = k - 1; j >= 0 && _keys[j] >= reach; --j )
+    if( box.overlaps(_boxes[_order[j]]) )
+      result.push_back(_order[j]);
+
+  for( int j = k + 1; j < n && _keys[j] <= box.hi(_axis); ++j )
+    if( box.overlaps(_boxes[_order[j]]) )
+      result.push_back(_order[j]);
+}
@@ -0,0 +1,41 @@
+#ifndef SWEEPANDPRUNE_H
+#define SWEEPANDPRUNE_H
+
+#include "broadphase.h"
+
+
+// Sweep and prune along one axis. The boxes stay sorted by their lower end across
+// frames, so the insertion sort of a new frame only moves the few boxes that
+// passed each other. Unlike the grid it has no cell size to tune, which suits
+// balls of widely different radii. The axis follows the largest spread of the
+// boxes, with some hysteresis so it does not flip between nearly equal axes.
+// A few boxes added or removed between frames keep the order.
+class SweepAndPrune : public BroadPhase {
+public:
+  void                  build( const std::vector<Aabb>& boxes ) override;
+  void                  update( int id, const Aabb& box ) override;
+  void                  reset() override;
+  void                  remove( int id, int last ) override;
+
+  void                  findPairs( std::vector<std::pair<int,int>>& pairs ) const override;
+  void                  query( int id, std::vector<int>& result ) override;
+
+  int                   getAxis() const;
+  long                  getSwapCount() const;   // insertion sort moves during the last build
+
+private:
+  std::vector<Aabb>     _boxes;
+  std::vector<int>      _order;      // box ids sorted by lower end along _axis
+  std::vector<float>    _keys;       // lower end of _order[k], kept next to each other for the sweep
+  std::vector<int>      _rank;       // position of each box in _order
+  int                   _axis {0};
+  float                 _maxExtent {0.0f};
+  long                  _swaps {0};
+
+  int                   chooseAxis() const;
+  void                  resort();
+  void                  moveToPlace( int k );
+
+}; // END class SweepAndPrune
+
+#endif // SWEEPANDPRUNE_H
@@ -0,0 +1,664 @@
+// Checks of the BallSim library against simple reference versions, no window or GL context
+
+// local
+#include "aabbtree.h"
+#include "ballstore.h"
+#include "collisionqueue.h"
+#include "controller.h"
+#include "demoscene.h"
+#include "heightfield.h"
+#include "spatialhash.h"
+#include "sweepandprune.h"
+#include "toikernel.h"
+#include "triplebuffer.h"
+#include "verletlist.h"
+
+// stl
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+
+    if( !ok ) {
+      std::cout << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  }
+
+  using Pairs = std::vector<std::pair<int,int>>;
+
+  std::vector<Aabb> randomBoxes(std::mt19937& rng, int count, float extent, float max_size) {
+
+    std::uniform_real_distribution<float> pos(-extent, extent);
+    std::uniform_real_distribution<float> size(0.05f, max_size);
+    std::vector<Aabb> boxes(count);
+    for( Aabb& box : boxes )
+      for( int k = 0; k < 3; ++k ) {
+        box.lo[k] = pos(rng);
+        box.hi[k] = box.lo(k) + size(rng);
+      }
+    return boxes;
+  }
+
+  void moveBoxes(std::mt19937& rng, std::vector<Aabb>& boxes, float step) {
+
+    std::uniform_real_distribution<float> d(-step, step);
+    for( Aabb& box : boxes )
+      for( int k = 0; k < 3; ++k ) {
+        const float s = d(rng);
+        box.lo[k] += s;
+        box.hi[k] += s;
+      }
+  }
+
+  Pairs bruteForcePairs(const std::vector<Aabb>& boxes) {
+
+    Pairs pairs;
+    for( int i = 0; i < int(boxes.size()); ++i )
+      for( int j = i + 1; j < int(boxes.size()); ++j )
+        if( boxes[i].overlaps(boxes[j]) )
+          pairs.emplace_back(i, j);
+    return pairs;
+  }
+
+  std::vector<int> bruteForceQuery(const std::vector<Aabb>& boxes, int id) {
+
+    std::vector<int> result;
+    for( int j = 0; j < int(boxes.size()); ++j )
+      if( j != id && boxes[id].overlaps(boxes[j]) )
+        result.push_back(j);
+    return result;
+  }
+
+  // a few frames of moving boxes, with some of them changed during the frame
+  void testBroadPhase(BroadPhase& bp, const std::string& name) {
+
+    std::mt19937 rng(7);
+    std::vector<Aabb> boxes = randomBoxes(rng, 500, 20.0f, 2.0f);
+    std::uniform_int_distribution<int> pick(0, int(boxes.size()) - 1);
+
+    for( int frame = 0; frame < 20; ++frame ) {
+
+      moveBoxes(rng, boxes, frame % 5 == 4 ? 3.0f : 0.2f);
+      bp.build(boxes);
+
+      Pairs pairs;
+      bp.findPairs(pairs);
+      std::sort(pairs.begin(), pairs.end());
+      check(pairs == bruteForcePairs(boxes), name + " pairs of frame " + std::to_string(frame));
+
+      for( int k = 0; k < 10; ++k ) {
+
+        const int id = pick(rng);
+        std::vector<Aabb> changed(1, boxes[id]);
+        moveBoxes(rng, changed, 2.0f);
+        boxes[id] = changed[0];
+        bp.update(id, boxes[id]);
+
+        std::vector<int> found;
+        bp.query(id, found);
+        std::sort(found.begin(), found.end());
+        check(found == bruteForceQuery(boxes, id), name + " query after update in frame " + std::to_string(frame));
+      }
+    }
+
+    // boxes removed and added between frames, the last box takes the id of a removed one
+    for( int frame = 0; frame < 10; ++frame ) {
+
+      for( int k = 0; k < 15; ++k ) {
+        if( k % 3 == 0 ) {
+          boxes.push_back(randomBoxes(rng, 1, 20.0f, 2.0f)[0]);
+          continue;
+        }
+        const int id = std::uniform_int_distribution<int>(0, int(boxes.size()) - 1)(rng);
+        const int last = int(boxes.size()) - 1;
+        bp.remove(id, last);
+        boxes[id] = boxes[last];
+        boxes.pop_back();
+      }
+      moveBoxes(rng, boxes, 0.2f);
+      bp.build(boxes);
+
+      Pairs pairs;
+      bp.findPairs(pairs);
+      std::sort(pairs.begin(), pairs.end());
+      check(pairs == bruteForcePairs(boxes), name + " pairs after removes in frame " + std::to_string(frame));
+
+      for( int k = 0; k < 10; ++k ) {
+        const int id = std::uniform_int_distribution<int>(0, int(boxes.size()) - 1)(rng);
+        std::vector<int> found;
+        bp.query(id, found);
+        std::sort(found.begin(), found.end());
+        check(found == bruteForceQuery(boxes, id), name + " query after removes in frame " + std::to_string(frame));
+      }
+    }
+
+    // ids given to other boxes
+    bp.reset();
+    boxes = randomBoxes(rng, 300, 10.0f, 2.0f);
+    bp.build(boxes);
+    Pairs pairs;
+    bp.findPairs(pairs);
+    std::sort(pairs.begin(), pairs.end());
+    check(pairs == bruteForcePairs(boxes), name + " pairs after reset");
+  }
+
+  void testBroadPhases() {
+
+    SpatialHash hash(2.0f);
+    testBroadPhase(hash, "SpatialHash");
+    SweepAndPrune sap;
+    testBroadPhase(sap, "SweepAndPrune");
+    VerletList verlet(0.5f);
+    testBroadPhase(verlet, "VerletList");
+  }
+
+  void testAabbTree() {
+
+    std::mt19937 rng(11);
+    std::vector<Aabb> walls = randomBoxes(rng, 60, 10.0f, 4.0f);
+    std::vector<Aabb> probes = randomBoxes(rng, 500, 12.0f, 2.0f);
+
+    AabbTree tree;
+    tree.build(walls);
+    check(tree.size() == int(walls.size()), "AabbTree size");
+
+    for( int pass = 0; pass < 2; ++pass ) {
+
+      for( const Aabb& probe : probes ) {
+
+        std::vector<int> found, expected;
+        tree.query(probe, found);
+        std::sort(found.begin(), found.end());
+        for( int j = 0; j < int(walls.size()); ++j )
+          if( probe.overlaps(walls[j]) )
+            expected.push_back(j);
+        check(found == expected, pass ? "AabbTree query after refit" : "AabbTree query");
+      }
+
+      // the walls move, the tree keeps its shape
+      moveBoxes(rng, walls, 1.5f);
+      tree.refit(walls);
+    }
+  }
+
+  void testCollisionQueue() {
+
+    auto floor = createDemoFloor();
+    BallStore store(floor);
+    std::vector<int> balls;
+    for( int i = 0; i < 10; ++i )
+      balls.push_back(store.add(GMlib::Point<float,3>(-8.0f + 1.5f * i, 0.0f, 5.0f),
+                                GMlib::Vector<float,3>(0.0f, 0.0f, 0.0f), 0.5f, 1.0));
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> x(0.0, 1.0);
+    std::uniform_int_distribution<int> ball(0, 9);
+
+    CollisionQueue queue;
+    std::vector<Collision> all;
+    for( int k = 0; k < 200; ++k ) {
+      const int a = ball(rng);
+      const int b = (a + 1 + ball(rng) % 9) % 10;
+      all.emplace_back(store, std::min(a, b), std::max(a, b), x(rng));
+      queue.push(all.back());
+    }
+    // ties on x, broken on the balls
+    for( int k = 0; k < 20; ++k ) {
+      all.emplace_back(store, k % 9, k % 9 + 1, 0.5);
+      queue.push(all.back());
+    }
+    check(queue.getSize() == int(all.size()), "CollisionQueue size");
+
+    std::sort(all.begin(), all.end());
+    bool ordered = true;
+    for( const Collision& expected : all ) {
+      const Collision col = queue.pop();
+      ordered = ordered && col.getX() == expected.getX() && col.getBall(0) == expected.getBall(0) &&
+                col.getBall(1) == expected.getBall(1);
+    }
+    check(ordered, "CollisionQueue pops in the order of Collision::operator<");
+    check(queue.empty(), "CollisionQueue empty after popping all");
+
+    // a ball that changed its path makes its collisions stale
+    queue.push(Collision(store, 0, 1, 0.2));
+    queue.push(Collision(store, 2, 3, 0.3));
+    store.setVelocity(1, GMlib::Vector<float,3>(1.0f, 0.0f, 0.0f));
+    const Collision first = queue.pop();
+    const Collision second = queue.pop();
+    check(!first.isValid(store), "CollisionQueue collision of a changed ball is stale");
+    check(second.isValid(store), "CollisionQueue collision of unchanged balls is valid");
+
+    // removing a ball drops its collisions, the ball moved into its slot keeps its own
+    queue.push(Collision(store, 4, 5, 0.1));
+    queue.push(Collision(store, 6, 9, 0.2));
+    queue.removeBall(4, 9);
+    check(queue.getSize() == 1, "CollisionQueue removeBall drops the collisions of the ball");
+    const Collision moved = queue.pop();
+    check(moved.getBall(0) == 6 && moved.getBall(1) == 4, "CollisionQueue removeBall renames the moved ball");
+  }
+
+  void testTripleBuffer() {
+
+    struct Frame {
+      int               number {-1};
+      std::vector<int>  values;
+    };
+
+    TripleBuffer<Frame> buffer;
+    const int frames = 20000;
+
+    std::thread writer([&buffer]() {
+      for( int f = 0; f < frames; ++f ) {
+        Frame& frame = buffer.getWriteBuffer();
+        frame.number = f;
+        frame.values.assign(64, f);
+        buffer.publish();
+      }
+    });
+
+    // every frame the reader sees is whole, and newer than the last one
+    int last = -1;
+    bool whole = true, newer = true;
+    while( last < frames - 1 ) {
+      if( !buffer.update() )
+        continue;
+      const Frame& frame = buffer.getReadBuffer();
+      newer = newer && frame.number > last;
+      whole = whole && int(frame.values.size()) == 64 &&
+              std::all_of(frame.values.begin(), frame.values.end(), [&frame](int v) { return v == frame.number; });
+      last = frame.number;
+    }
+    writer.join();
+
+    check(whole, "TripleBuffer frames are not torn");
+    check(newer, "TripleBuffer frames arrive in order");
+    check(!buffer.update(), "TripleBuffer no frame after the last one was read");
+  }
+
+  void testHandles() {
+
+    auto floor = createDemoFloor();
+    BallStore store(floor);
+    const GMlib::Vector<float,3> still(0.0f, 0.0f, 0.0f);
+    const int a = store.add(GMlib::Point<float,3>(-2.0f, 0.0f, 5.0f), still, 0.5f, 1.0);
+    const int b = store.add(GMlib::Point<float,3>( 0.0f, 0.0f, 5.0f), still, 0.5f, 1.0);
+    const int c = store.add(GMlib::Point<float,3>( 2.0f, 0.0f, 5.0f), still, 0.5f, 1.0);
+
+    check(store.remove(a) == 0, "BallStore remove returns the slot of the ball");
+    check(!store.isValid(a), "BallStore removed handle is invalid");
+    check(store.remove(a) == -1, "BallStore removing twice fails");
+    check(store.isValid(b) && store.isValid(c), "BallStore other handles stay valid");
+    check(store.getHandle(store.getSlot(c)) == c, "BallStore last ball moved into the free slot");
+
+    // the number comes back with the next generation, the old handle stays invalid
+    const int d = store.add(GMlib::Point<float,3>(-2.0f, 0.0f, 5.0f), still, 0.5f, 1.0);
+    check(BallStore::getHandleNumber(d) == BallStore::getHandleNumber(a), "BallStore reuses the handle number");
+    check(d != a, "BallStore reused handle has a new generation");
+    check(store.isValid(d) && !store.isValid(a), "BallStore old generation rejected");
+    check(store.size() == 3, "BallStore size after reuse");
+
+    // a handle is retired once, before the remove that follows it
+    check(!store.retireHandle(a), "BallStore old generation can not be retired");
+    check(store.retireHandle(d), "BallStore retires a live handle");
+    check(!store.retireHandle(d), "BallStore retiring twice fails");
+    check(store.remove(d) >= 0, "BallStore removes a retired handle");
+
+    // the numbers run out below the generation bits
+    BallStore full(floor);
+    int last = 0;
+    for( int k = 0; k < (1 << BallStore::HandleBits); ++k )
+      last = full.reserveHandle();
+    check(last == (1 << BallStore::HandleBits) - 1, "BallStore gives out every handle number");
+    check(full.reserveHandle() == -1, "BallStore fails when the handle numbers run out");
+  }
+
+  void testHeightField() {
+
+    auto floor = createDemoFloor();
+    float errors[2];
+    const int resolutions[2] = { 32, 128 };
+
+    for( int r = 0; r < 2; ++r ) {
+
+      HeightField field;
+      check(field.build(*floor, resolutions[r]), "HeightField builds over the demo floor");
+      errors[r] = field.getMaxHeightError();
+
+      // points on the surface are found again within the measured bounds
+      std::mt19937 rng(5);
+      std::uniform_real_distribution<float> s(0.02f, 0.98f);
+      float height = 0.0f, angle = 0.0f;
+      for( int k = 0; k < 2000; ++k ) {
+
+        const float u = floor->getParStartU() + s(rng) * floor->getParDeltaU();
+        const float v = floor->getParStartV() + s(rng) * floor->getParDeltaV();
+        const GMlib::DMatrix<GMlib::Vector<float,3>>& m = floor->evaluate(u, v, 1, 1);
+        const GMlib::Point<float,3> p = m[0][0];
+        const GMlib::Vector<float,3> n = GMlib::UnitVector<float,3>(m[1][0] ^ m[0][1]);
+
+        SurfaceSample sample;
+        field.project(p, sample);
+        height = std::max(height, (sample.point - p).getLength());
+        angle  = std::max(angle, std::atan2((sample.normal ^ n).getLength(), std::abs(sample.normal * n)));
+      }
+
+      // the build measures at a few points of each cell only, allow twice that
+      const std::string res = std::to_string(resolutions[r]);
+      check(height <= 2.0f * field.getMaxHeightError() + 1e-5f, "HeightField height error bound at resolution " + res);
+      check(angle <= 2.0f * field.getMaxNormalError() + 1e-5f, "HeightField normal error bound at resolution " + res);
+    }
+    check(errors[1] < errors[0], "HeightField error shrinks with the resolution");
+  }
+
+  // the terms of Controller::findBBCol at the start of a frame, in the same precision
+  struct ScalarRoot {
+    double a, b, c, disc, x;
+
+    ScalarRoot(const GMlib::Point<float,3>& p1, const GMlib::Point<float,3>& p2,
+               const GMlib::Vector<float,3>& ds1, const GMlib::Vector<float,3>& ds2, float r1, float r2) {
+
+      const GMlib::Vector<float,3> k = ds1 - ds2;
+      const GMlib::Point<float,3>  q = p1 - p2;
+      const double r = double(r1) + double(r2);
+      a = k * k;
+      b = 2 * q * k;
+      c = (q * q) - r * r;
+      disc = b * b - 4 * a * c;
+      x = disc > 0.0 ? (-b - std::sqrt(disc)) / (2.0 * a) : 0.0;
+    }
+
+    // findBBCol looks at the pair: it overlaps or has a root in (prevX, maxX]
+    bool accepts(double prevX, double maxX) const {
+      return c < 0 || (disc > 0.0 && prevX < x && x <= maxX);
+    }
+
+    // far from touching, grazing and the ends of the range
+    bool clearlyMisses(double prevX, double maxX) const {
+      return c > 0.01 && (disc < -0.01 * (b * b + std::abs(4 * a * c)) ||
+                          (disc > 0.0 && (x < prevX - 0.01 || x > maxX + 0.01)));
+    }
+  };
+
+  // random pairs, most of them built to touch near the ends of the range, classified by
+  // every instruction set the cpu has. A pair the scalar test accepts must never be
+  // passed over, and the kernel must still pass over the clear misses
+  void testToiKernel() {
+
+    const int count = 20000;
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> radius(0.1f, 1.0f);
+    std::uniform_real_distribution<float> when(-0.5f, 5.0f);
+    std::uniform_real_distribution<float> noise(-1e-4f, 1e-4f);
+
+    std::vector<float> pos(6 * count), ds(6 * count), radii(2 * count);
+    std::vector<int> first(count), second(count);
+    for( int k = 0; k < count; ++k ) {
+
+      const GMlib::Point<float,3>  offset(10.0f * unit(rng), 10.0f * unit(rng), unit(rng));
+      const GMlib::Vector<float,3> ds1(unit(rng), unit(rng), 0.1f * unit(rng));
+      const GMlib::Vector<float,3> ds2(unit(rng), unit(rng), 0.1f * unit(rng));
+      const float r1 = radius(rng), r2 = radius(rng);
+
+      GMlib::Vector<float,3> q;
+      if( k % 4 == 0 )   // anywhere
+        q = GMlib::Vector<float,3>(4.0f * unit(rng), 4.0f * unit(rng), unit(rng));
+      else {             // touching at time t, within a rounding error
+        GMlib::Vector<float,3> n(unit(rng), unit(rng), unit(rng));
+        n = (1.0f / std::max(1e-3f, float(n.getLength()))) * n;
+        const float t = k % 4 == 1 ? when(rng) : float(k % 3) + noise(rng);   // or right at 0, 1 or 2
+        q = ((r1 + r2) * (1.0f + noise(rng))) * n - t * (ds1 - ds2);
+      }
+
+      const GMlib::Point<float,3> p1 = offset + q;
+      for( int c = 0; c < 3; ++c ) {
+        pos[6 * k + c]     = p1(c);
+        pos[6 * k + 3 + c] = offset(c);
+        ds[6 * k + c]      = ds1(c);
+        ds[6 * k + 3 + c]  = ds2(c);
+      }
+      radii[2 * k] = r1;
+      radii[2 * k + 1] = r2;
+      first[k] = 2 * k;
+      second[k] = 2 * k + 1;
+    }
+
+    const float ranges[3][2] = { {0.0f, 1.0f}, {0.0f, 4.0f}, {0.5f, 1.0f} };
+    const ToiKernel::Isa isas[3] = { ToiKernel::Isa::Scalar, ToiKernel::Isa::Avx2, ToiKernel::Isa::Avx512 };
+    for( const ToiKernel::Isa isa : isas ) {
+
+      if( !ToiKernel::isSupported(isa) )
+        continue;
+      ToiKernel kernel;
+      kernel.setIsa(isa);
+
+      for( const auto& range : ranges ) {
+
+        std::vector<unsigned char> flags(count);
+        kernel.classify(pos.data(), ds.data(), radii.data(), first.data(), second.data(), count,
+                        range[0], range[1], flags.data());
+
+        int missed = 0, kept = 0, accepted = 0, clear = 0;
+        for( int k = 0; k < count; ++k ) {
+
+          const int i = 2 * k, j = 2 * k + 1;
+          const ScalarRoot root(GMlib::Point<float,3>(pos[3*i], pos[3*i+1], pos[3*i+2]),
+                                GMlib::Point<float,3>(pos[3*j], pos[3*j+1], pos[3*j+2]),
+                                GMlib::Vector<float,3>(ds[3*i], ds[3*i+1], ds[3*i+2]),
+                                GMlib::Vector<float,3>(ds[3*j], ds[3*j+1], ds[3*j+2]), radii[i], radii[j]);
+          const bool accepts = root.accepts(range[0], range[1]);
+          const bool misses  = root.clearlyMisses(range[0], range[1]);
+          accepted += accepts;
+          clear    += misses;
+          if( !flags[k] && accepts )
+            missed++;
+          if( flags[k] && misses )
+            kept++;
+        }
+
+        const std::string name = std::string("ToiKernel ") + ToiKernel::getName(isa) + " (" +
+                                 std::to_string(range[0]) + ", " + std::to_string(range[1]) + "]";
+        check(accepted > count / 10 && clear > count / 10, name + " has both kinds of pairs");
+        check(missed == 0, name + " passed over " + std::to_string(missed) + " pairs findBBCol accepts");
+        check(kept == 0, name + " kept " + std::to_string(kept) + " clear misses");
+      }
+    }
+  }
+
+  // balls at rest fall asleep, a push wakes them however weak it is, and they fall asleep again
+  void testSleep() {
+
+    auto floor = new GMlib::PPlane<float>(GMlib::Point<float,3>(-10.0f, -10.0f, 0.0f),
+                                          GMlib::Vector<float,3>(20.0f, 0.0f, 0.0f), GMlib::Vector<float,3>(0.0f, 20.0f, 0.0f));
+    Controller controller(floor);
+    for( PWall* wall : createDemoWalls() )
+      controller.insertWall(wall);
+    controller.setSleepThresholds(0.05f, 0.002f, 30);
+
+    const GMlib::Vector<float,3> still(0.0f, 0.0f, 0.0f);
+    std::vector<int> balls;
+    for( int k = 0; k < 5; ++k )
+      balls.push_back(controller.addBall(GMlib::Point<float,3>(-6.0f + 3.0f * k, 4.0f, 0.5f), still, 0.5f, 5.0));
+    const int target = balls[2];
+
+    for( int f = 0; f < 40; ++f )
+      controller.step(1.0 / 60.0);
+    BallStore& store = controller.getStore();
+    check(controller.getSleepingCount() == int(balls.size()), "Sleep balls at rest fall asleep");
+
+    // a light ball leaves the target far below the sleep speed, elastic hit: 2*0.1/5.1 of its speed
+    const GMlib::Point<float,3> start = store.getPos(store.getSlot(target));
+    controller.addBall(start + GMlib::Vector<float,3>(0.0f, -1.5f, 0.0f), GMlib::Vector<float,3>(0.0f, 1.0f, 0.0f), 0.5f, 0.1);
+    for( int f = 0; f < 40 && store.isAsleep(store.getSlot(target)); ++f )
+      controller.step(1.0 / 60.0);
+    const int slot = store.getSlot(target);
+    check(!store.isAsleep(slot), "Sleep a weak hit wakes the ball");
+    check(store.getVelocity(slot).getLength() > 0.02f && store.getVelocity(slot).getLength() < 0.05f,
+          "Sleep the woken ball keeps the momentum of the hit");
+
+    for( int f = 0; f < 40; ++f )
+      controller.step(1.0 / 60.0);
+    check(store.isAsleep(store.getSlot(target)), "Sleep the slow ball falls asleep again");
+    check((store.getPos(store.getSlot(target)) - start).getLength() > 0.01f, "Sleep the woken ball moved before");
+  }
+
+  // positions and velocities in handle order, the same for any slot order of the store
+  unsigned long long stateChecksum(const BallStore& store) {
+
+    unsigned long long h = 14695981039346656037ull;
+    auto add = [&h](const GMlib::Vector<float,3>& p) {
+      unsigned char bytes[3 * sizeof(float)];
+      for( int k = 0; k < 3; ++k )
+        std::memcpy(bytes + k * sizeof(float), &p(k), sizeof(float));
+      for( unsigned char b : bytes ) {
+        h ^= b;
+        h *= 1099511628211ull;
+      }
+    };
+
+    std::vector<std::pair<int,int>> balls;
+    for( int i = 0; i < store.size(); ++i )
+      balls.push_back(std::make_pair(store.getHandle(i), i));
+    std::sort(balls.begin(), balls.end());
+
+    for( const std::pair<int,int>& ball : balls ) {
+      add(store.getPos(ball.second));
+      add(store.getVelocity(ball.second));
+    }
+    return h;
+  }
+
+  // clusters of balls far apart on a flat floor, each one an island, the first one too big
+  // for a member search. Returns the checksum after the frames and counts the islands run
+  unsigned long long runClusters(bool islands, int frames, long& island_count, long& large_count) {
+
+    auto floor = new GMlib::PPlane<float>(GMlib::Point<float,3>(-10.0f, -10.0f, 0.0f),
+                                          GMlib::Vector<float,3>(20.0f, 0.0f, 0.0f), GMlib::Vector<float,3>(0.0f, 20.0f, 0.0f));
+    Controller controller(floor);
+    for( PWall* wall : createDemoWalls() )
+      controller.insertWall(wall);
+    controller.setThreadCount(4);
+    controller.setParallelIslands(islands);
+    controller.setMaxIslandSize(20);
+
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> speed(-2.0f, 2.0f);
+    const float centres[5][2] = { {-5.0f, -5.0f}, {5.0f, -5.0f}, {-5.0f, 5.0f}, {5.0f, 5.0f}, {0.0f, 0.0f} };
+    for( int c = 0; c < 5; ++c ) {
+      const int side = c == 0 ? 6 : 3;
+      for( int i = 0; i < side; ++i )
+        for( int j = 0; j < side; ++j )
+          controller.addBall(GMlib::Point<float,3>(centres[c][0] + 0.5f * (i - side / 2), centres[c][1] + 0.5f * (j - side / 2), 0.2f),
+                             GMlib::Vector<float,3>(speed(rng), speed(rng), 0.0f), 0.2f, 1.0);
+    }
+
+    island_count = large_count = 0;
+    for( int f = 0; f < frames; ++f ) {
+      controller.step(1.0 / 60.0);
+      island_count += controller.getIslandCount();
+      large_count  += controller.getLargeIslandCount();
+    }
+    return stateChecksum(controller.getStore());
+  }
+
+  // the same scene with and without reordering the store, a few balls removed on the way.
+  // Returns the checksum after the frames; each reorder is checked against the handles
+  unsigned long long runReorder(int interval, int frames, long& reorders, int& moved) {
+
+    Controller controller(createDemoFloor());
+    for( PWall* wall : createDemoWalls() )
+      controller.insertWall(wall);
+    controller.setReorderInterval(interval);
+
+    std::mt19937 rng(29);
+    std::uniform_real_distribution<float> speed(-4.0f, 4.0f);
+    std::vector<int> handles;
+    for( int i = 0; i < 16; ++i )
+      for( int j = 0; j < 16; ++j )
+        handles.push_back(controller.addBall(GMlib::Point<float,3>(-8.5f + 1.1f * i, -8.5f + 1.1f * j, 1.0f),
+                                             GMlib::Vector<float,3>(speed(rng), speed(rng), 0.0f), 0.4f, 1.0));
+
+    const BallStore& store = controller.getStore();
+    bool consistent = true;
+    for( int f = 0; f < frames; ++f ) {
+      if( f == frames / 3 )
+        for( int k = 0; k < 20; ++k )
+          controller.removeBall(handles[7 * k]);
+      controller.step(1.0 / 60.0);
+
+      for( int slot = 0; slot < store.size(); ++slot )
+        consistent = consistent && store.getSlot(store.getHandle(slot)) == slot;
+      for( int handle : handles )
+        if( store.isValid(handle) )
+          consistent = consistent && store.getHandle(store.getSlot(handle)) == handle;
+    }
+    check(consistent, "Reorder every handle finds its ball after " + std::to_string(interval) + " frame sorts");
+
+    reorders = controller.getReorderCount();
+    moved = 0;
+    for( size_t k = 0; k < handles.size(); ++k )
+      if( store.isValid(handles[k]) && store.getSlot(handles[k]) != int(k) )
+        moved++;
+    return stateChecksum(store);
+  }
+
+  void testReorder() {
+
+    long reorders = 0, unsorted = 0;
+    int moved = 0, unsorted_moved = 0;
+    const unsigned long long sorted = runReorder(10, 90, reorders, moved);
+    const unsigned long long kept   = runReorder(0, 90, unsorted, unsorted_moved);
+    check(reorders > 0 && unsorted == 0, "Reorder runs at the interval only");
+    check(moved > unsorted_moved, "Reorder moves balls to other slots");
+    check(sorted == kept, "Reorder gives the result without reordering");
+  }
+
+  void testIslands() {
+
+    long islands = 0, large = 0, serial_islands = 0, serial_large = 0;
+    const unsigned long long parallel = runClusters(true, 30, islands, large);
+    const unsigned long long serial   = runClusters(false, 30, serial_islands, serial_large);
+    check(islands > 0, "Islands resolved in parallel");
+    check(large > 0, "Islands a large island asks the broad phase");
+    check(serial_islands == 0, "Islands off resolves serially");
+    check(parallel == serial, "Islands give the serial result");
+  }
+
+} // END anonymous namespace
+
+
+int main() {
+
+  testBroadPhases();
+  testAabbTree();
+  testCollisionQueue();
+  testTripleBuffer();
+  testHandles();
+  testHeightField();
+  testSleep();
+  testIslands();
+  testReorder();
+  testToiKernel();
+
+  if( failures ) {
+    std::cout << failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,248 @@
+#include "toikernel.h"
+
+// stl
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TOIKERNEL_X86
+#include <immintrin.h>
+#endif
+
+
+namespace {
+
+  const float RootTol = 1e-4f;   // relative error of a float root
+  const float RootAbs = 1e-6f;
+  const float SignTol = 1e-5f;   // relative error of c and the discriminant
+
+  unsigned char classifyPair(const float* pos, const float* ds, const float* radius, int i, int j,
+                             float prevX, float maxX) {
+
+    const float qx = pos[3*i]   - pos[3*j];
+    const float qy = pos[3*i+1] - pos[3*j+1];
+    const float qz = pos[3*i+2] - pos[3*j+2];
+    const float kx = ds[3*i]    - ds[3*j];
+    const float ky = ds[3*i+1]  - ds[3*j+1];
+    const float kz = ds[3*i+2]  - ds[3*j+2];
+    const float r  = radius[i] + radius[j];
+
+    const float qq   = qx*qx + qy*qy + qz*qz;
+    const float rr   = r*r;
+    const float a    = kx*kx + ky*ky + kz*kz;
+    const float b    = 2.0f * (qx*kx + qy*ky + qz*kz);
+    const float c    = qq - rr;
+    const float ac4  = 4.0f * a * c;
+    const float disc = b*b - ac4;
+
+    const float s   = std::sqrt(std::max(disc, 0.0f));
+    const float x   = (-b - s) / (2.0f * a);
+    const float tol = RootTol * (std::fabs(b) + s) / (2.0f * a) + RootAbs;
+
+    // a == 0: the balls keep their distance, findBBCol finds no root either
+    const bool miss = a == 0.0f || disc <= -SignTol * (b*b + std::fabs(ac4)) ||
+                      x + tol <= prevX || x - tol > maxX;
+
+    unsigned char flags = miss ? 0 : ToiKernel::Hit;
+    if( c < SignTol * (qq + rr) )
+      flags |= ToiKernel::Overlap;
+    return flags;
+  }
+
+#ifdef TOIKERNEL_X86
+
+  __attribute__((target("avx2")))
+  int classifyAvx2(const float* pos, const float* ds, const float* radius, const int* first, const int* second,
+                   int count, float prevX, float maxX, unsigned char* flags) {
+
+    const __m256  zero    = _mm256_setzero_ps();
+    const __m256  two     = _mm256_set1_ps(2.0f);
+    const __m256  four    = _mm256_set1_ps(4.0f);
+    const __m256  rootTol = _mm256_set1_ps(RootTol);
+    const __m256  rootAbs = _mm256_set1_ps(RootAbs);
+    const __m256  signTol = _mm256_set1_ps(SignTol);
+    const __m256  negTol  = _mm256_set1_ps(-SignTol);
+    const __m256  absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256  prev    = _mm256_set1_ps(prevX);
+    const __m256  max     = _mm256_set1_ps(maxX);
+    const __m256i three   = _mm256_set1_epi32(3);
+
+    int k = 0;
+    for( ; k + 8 <= count; k += 8 ) {
+
+      const __m256i i  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + k));
+      const __m256i j  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(second + k));
+      const __m256i i3 = _mm256_mullo_epi32(i, three);
+      const __m256i j3 = _mm256_mullo_epi32(j, three);
+
+      const __m256 qx = _mm256_sub_ps(_mm256_i32gather_ps(pos,     i3, 4), _mm256_i32gather_ps(pos,     j3, 4));
+      const __m256 qy = _mm256_sub_ps(_mm256_i32gather_ps(pos + 1, i3, 4), _mm256_i32gather_ps(pos + 1, j3, 4));
+      const __m256 qz = _mm256_sub_ps(_mm256_i32gather_ps(pos + 2, i3, 4), _mm256_i32gather_ps(pos + 2, j3, 4));
+      const __m256 kx = _mm256_sub_ps(_mm256_i32gather_ps(ds,      i3, 4), _mm256_i32gather_ps(ds,      j3, 4));
+      const __m256 ky = _mm256_sub_ps(_mm256_i32gather_ps(ds + 1,  i3, 4), _mm256_i32gather_ps(ds + 1,  j3, 4));
+      const __m256 kz = _mm256_sub_ps(_mm256_i32gather_ps(ds + 2,  i3, 4), _mm256_i32gather_ps(ds + 2,  j3, 4));
+      const __m256 r  = _mm256_add_ps(_mm256_i32gather_ps(radius,  i,  4), _mm256_i32gather_ps(radius,  j,  4));
+
+      const __m256 qq   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy)), _mm256_mul_ps(qz, qz));
+      const __m256 rr   = _mm256_mul_ps(r, r);
+      const __m256 a    = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(kx, kx), _mm256_mul_ps(ky, ky)), _mm256_mul_ps(kz, kz));
+      const __m256 qk   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(qx, kx), _mm256_mul_ps(qy, ky)), _mm256_mul_ps(qz, kz));
+      const __m256 b    = _mm256_mul_ps(two, qk);
+      const __m256 c    = _mm256_sub_ps(qq, rr);
+      const __m256 ac4  = _mm256_mul_ps(_mm256_mul_ps(four, a), c);
+      const __m256 bb   = _mm256_mul_ps(b, b);
+      const __m256 disc = _mm256_sub_ps(bb, ac4);
+
+      const __m256 s    = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+      const __m256 a2   = _mm256_mul_ps(two, a);
+      const __m256 x    = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), s), a2);
+      const __m256 tol  = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(rootTol, _mm256_add_ps(_mm256_and_ps(b, absMask), s)), a2), rootAbs);
+
+      __m256 miss = _mm256_cmp_ps(a, zero, _CMP_EQ_OQ);
+      miss = _mm256_or_ps(miss, _mm256_cmp_ps(disc, _mm256_mul_ps(negTol, _mm256_add_ps(bb, _mm256_and_ps(ac4, absMask))), _CMP_LE_OQ));
+      miss = _mm256_or_ps(miss, _mm256_cmp_ps(_mm256_add_ps(x, tol), prev, _CMP_LE_OQ));
+      miss = _mm256_or_ps(miss, _mm256_cmp_ps(_mm256_sub_ps(x, tol), max, _CMP_GT_OQ));
+      const __m256 overlap = _mm256_cmp_ps(c, _mm256_mul_ps(signTol, _mm256_add_ps(qq, rr)), _CMP_LT_OQ);
+
+      const int hits     = ~_mm256_movemask_ps(miss);
+      const int overlaps = _mm256_movemask_ps(overlap);
+      for( int l = 0; l < 8; ++l )
+        flags[k + l] = ((hits >> l) & 1) | (((overlaps >> l) & 1) << 1);
+    }
+    return k;
+  }
+
+  // the AVX-512 headers of gcc 12 start gathers and maxima from an undefined register
+#if !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+  __attribute__((target("avx512f")))
+  int classifyAvx512(const float* pos, const float* ds, const float* radius, const int* first, const int* second,
+                     int count, float prevX, float maxX, unsigned char* flags) {
+
+    const __m512  zero    = _mm512_setzero_ps();
+    const __m512  two     = _mm512_set1_ps(2.0f);
+    const __m512  four    = _mm512_set1_ps(4.0f);
+    const __m512  rootTol = _mm512_set1_ps(RootTol);
+    const __m512  rootAbs = _mm512_set1_ps(RootAbs);
+    const __m512  signTol = _mm512_set1_ps(SignTol);
+    const __m512  negTol  = _mm512_set1_ps(-SignTol);
+    const __m512  prev    = _mm512_set1_ps(prevX);
+    const __m512  max     = _mm512_set1_ps(maxX);
+    const __m512i three   = _mm512_set1_epi32(3);
+
+    int k = 0;
+    for( ; k + 16 <= count; k += 16 ) {
+
+      const __m512i i  = _mm512_loadu_si512(first + k);
+      const __m512i j  = _mm512_loadu_si512(second + k);
+      const __m512i i3 = _mm512_mullo_epi32(i, three);
+      const __m512i j3 = _mm512_mullo_epi32(j, three);
+
+      const __m512 qx = _mm512_sub_ps(_mm512_i32gather_ps(i3, pos,     4), _mm512_i32gather_ps(j3, pos,     4));
+      const __m512 qy = _mm512_sub_ps(_mm512_i32gather_ps(i3, pos + 1, 4), _mm512_i32gather_ps(j3, pos + 1, 4));
+      const __m512 qz = _mm512_sub_ps(_mm512_i32gather_ps(i3, pos + 2, 4), _mm512_i32gather_ps(j3, pos + 2, 4));
+      const __m512 kx = _mm512_sub_ps(_mm512_i32gather_ps(i3, ds,      4), _mm512_i32gather_ps(j3, ds,      4));
+      const __m512 ky = _mm512_sub_ps(_mm512_i32gather_ps(i3, ds + 1,  4), _mm512_i32gather_ps(j3, ds + 1,  4));
+      const __m512 kz = _mm512_sub_ps(_mm512_i32gather_ps(i3, ds + 2,  4), _mm512_i32gather_ps(j3, ds + 2,  4));
+      const __m512 r  = _mm512_add_ps(_mm512_i32gather_ps(i,  radius,  4), _mm512_i32gather_ps(j,  radius,  4));
+
+      const __m512 qq   = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(qx, qx), _mm512_mul_ps(qy, qy)), _mm512_mul_ps(qz, qz));
+      const __m512 rr   = _mm512_mul_ps(r, r);
+      const __m512 a    = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(kx, kx), _mm512_mul_ps(ky, ky)), _mm512_mul_ps(kz, kz));
+      const __m512 qk   = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(qx, kx), _mm512_mul_ps(qy, ky)), _mm512_mul_ps(qz, kz));
+      const __m512 b    = _mm512_mul_ps(two, qk);
+      const __m512 c    = _mm512_sub_ps(qq, rr);
+      const __m512 ac4  = _mm512_mul_ps(_mm512_mul_ps(four, a), c);
+      const __m512 bb   = _mm512_mul_ps(b, b);
+      const __m512 disc = _mm512_sub_ps(bb, ac4);
+
+      const __m512 s    = _mm512_sqrt_ps(_mm512_max_ps(disc, zero));
+      const __m512 a2   = _mm512_mul_ps(two, a);
+      const __m512 x    = _mm512_div_ps(_mm512_sub_ps(_mm512_sub_ps(zero, b), s), a2);
+      const __m512 tol  = _mm512_add_ps(_mm512_div_ps(_mm512_mul_ps(rootTol, _mm512_add_ps(_mm512_abs_ps(b), s)), a2), rootAbs);
+
+      __mmask16 miss = _mm512_cmp_ps_mask(a, zero, _CMP_EQ_OQ);
+      miss |= _mm512_cmp_ps_mask(disc, _mm512_mul_ps(negTol, _mm512_add_ps(bb, _mm512_abs_ps(ac4))), _CMP_LE_OQ);
+      miss |= _mm512_cmp_ps_mask(_mm512_add_ps(x, tol), prev, _CMP_LE_OQ);
+      miss |= _mm512_cmp_ps_mask(_mm512_sub_ps(x, tol), max, _CMP_GT_OQ);
+      const __mmask16 overlap = _mm512_cmp_ps_mask(c, _mm512_mul_ps(signTol, _mm512_add_ps(qq, rr)), _CMP_LT_OQ);
+
+      const int hits     = ~int(miss);
+      const int overlaps = int(overlap);
+      for( int l = 0; l < 16; ++l )
+        flags[k + l] = ((hits >> l) & 1) | (((overlaps >> l) & 1) << 1);
+    }
+    return k;
+  }
+#if !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+} // END anonymous namespace
+
+
+ToiKernel::ToiKernel() : _isa{best()} {}
+
+bool ToiKernel::isSupported(Isa isa) {
+
+  switch( isa ) {
+#ifdef TOIKERNEL_X86
+    case Isa::Avx2:   return __builtin_cpu_supports("avx2");
+    case Isa::Avx512: return __builtin_cpu_supports("avx512f");
+#else
+    case Isa::Avx2:   return false;
+    case Isa::Avx512: return false;
+#endif
+    default:          return true;
+  }
+}
+
+ToiKernel::Isa ToiKernel::best() {
+
+  if( isSupported(Isa::Avx512) ) return Isa::Avx512;
+  if( isSupported(Isa::Avx2) )   return Isa::Avx2;
+  return Isa::Scalar;
+}
+
+const char* ToiKernel::getName(Isa isa) {
+
+  switch( isa ) {
+    case Isa::Avx2:   return "avx2";
+    case Isa::Avx512: return "avx512";
+    default:          return "scalar";
+  }
+}
+
+bool ToiKernel::setIsa(Isa isa) {
+
+  if( !isSupported(isa) )
+    return false;
+  _isa = isa;
+  return true;
+}
+
+ToiKernel::Isa ToiKernel::getIsa() const {
+
+  return _isa;
+}
+
+void ToiKernel::classify(const float* pos, const float* ds, const float* radius,
+                         const int* first, const int* second, int count,
+                         float prevX, float maxX, unsigned char* flags) const {
+
+  int k = 0;
+#ifdef TOIKERNEL_X86
+  if( _isa == Isa::Avx512 )
+    k = classifyAvx512(pos, ds, radius, first, second, count, prevX, maxX, flags);
+  else if( _isa == Isa::Avx2 )
+    k = classifyAvx2(pos, ds, radius, first, second, count, prevX, maxX, flags);
+#endif
+
+  // the rest of a batch, or all without SIMD
+  for( ; k < count; ++k )
+    flags[k] = classifyPair(pos, ds, radius, first[k], second[k], prevX, maxX);
+}
@@ -0,0 +1,38 @@
+#ifndef TOIKERNEL_H
+#define TOIKERNEL_H
+
+
+// Batched first test of ball-ball pairs. For each pair it solves the time of impact
+// |q + x k|^2 = r^2 in float, q and k being the differences of the positions and
+// steps and r the sum of the radii, eight or sixteen pairs at a time with AVX2 or
+// AVX-512, and flags the pairs findBBCol has to look at: a root in (prevX, maxX]
+// or balls that already overlap. The float root may differ from the one of
+// findBBCol, so a pair is only passed over when its root is off the range by more than
+//   1e-4 * (|b| + sqrt(b^2 - 4ac)) / (2a) + 1e-6
+// and its discriminant or c is clearly below zero (by 1e-5 of the size of its terms).
+// Flagged pairs are solved again by findBBCol, so the events are those of the scalar path.
+class ToiKernel {
+public:
+  enum class Isa { Scalar, Avx2, Avx512 };
+  enum Flag : unsigned char { Hit = 1, Overlap = 2 };
+
+  ToiKernel();   // the widest instruction set the cpu supports
+
+  static Isa            best();
+  static bool           isSupported( Isa isa );
+  static const char*    getName( Isa isa );
+
+  bool                  setIsa( Isa isa );   // false, and the old one kept, if the cpu lacks it
+  Isa                   getIsa() const;
+
+  // pos and ds hold 3 floats per ball, the pairs are (first[k], second[k])
+  void                  classify( const float* pos, const float* ds, const float* radius,
+                                  const int* first, const int* second, int count,
+                                  float prevX, float maxX, unsigned char* flags ) const;
+
+private:
+  Isa                   _isa;
+
+}; // END class ToiKernel
+
+#endif // TOIKERNEL_H
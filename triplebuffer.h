@@ -0,0 +1,40 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+// stl
+#include <atomic>
+
+
+// Lock-free handoff of whole frames from one writer thread to one reader thread.
+// The writer fills getWriteBuffer() and publishes it, the reader picks up the newest
+// published frame with update(). Neither side ever waits for the other.
+template <typename T>
+class TripleBuffer {
+public:
+  T&                getWriteBuffer()        { return _slots[_write]; }
+  const T&          getReadBuffer() const   { return _slots[_read]; }
+
+  // hands the write buffer to the reader and takes over the buffer it left
+  void              publish() {
+    _write = _shared.exchange( _write | FRESH, std::memory_order_acq_rel ) & INDEX;
+  }
+
+  // switches the read buffer to the newest published frame, false if there is none
+  bool              update() {
+    if( !(_shared.load( std::memory_order_relaxed ) & FRESH) )
+      return false;
+    _read = _shared.exchange( _read, std::memory_order_acq_rel ) & INDEX;
+    return true;
+  }
+
+private:
+  enum { INDEX = 3, FRESH = 4 };
+
+  T                 _slots[3];
+  int               _write {0};
+  std::atomic<int>  _shared {1};
+  int               _read {2};
+
+}; // END class TripleBuffer
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,281 @@
+#include "verletlist.h"
+
+// stl
+#include <algorithm>
+#include <limits>
+
+
+VerletList::VerletList(float skin) : _skin{skin} {}
+
+void VerletList::setSkin(float skin) {
+
+  _skin = std::max(0.0f, skin);
+  _grown.clear();   // lists of the old skin are rebuilt with the next frame
+}
+
+float VerletList::getSkin() const {
+
+  return _skin;
+}
+
+void VerletList::setMaxEscaped(float fraction) {
+
+  _max_escaped = std::max(0.0f, fraction);
+}
+
+long VerletList::getRebuildCount() const {
+
+  return _rebuilds;
+}
+
+double VerletList::getAverageListLength() const {
+
+  return _boxes.empty() ? 0.0 : double(_neighbours.size()) / _boxes.size();
+}
+
+bool VerletList::inside(int id) const {
+
+  const Aabb& box   = _boxes[id];
+  const Aabb& grown = _grown[id];
+  for( int k = 0; k < 3; ++k )
+    if( box.lo(k) < grown.lo(k) || box.hi(k) > grown.hi(k) )
+      return false;
+  return true;
+}
+
+void VerletList::rebuild() {
+
+  const int   n    = int(_boxes.size());
+  const float half = 0.5f * _skin;
+
+  _grown.resize(n);
+  for( int i = 0; i < n; ++i )
+    for( int k = 0; k < 3; ++k ) {
+      _grown[i].lo[k] = _boxes[i].lo(k) - half;
+      _grown[i].hi[k] = _boxes[i].hi(k) + half;
+    }
+
+  _search.build(_grown);
+  _search.findPairs(_pairs);
+
+  // both directions, counting sort by the first box
+  _start.assign(n + 1, 0);
+  for( const auto& p : _pairs ) {
+    _start[p.first + 1]++;
+    _start[p.second + 1]++;
+  }
+  for( int i = 0; i < n; ++i )
+    _start[i + 1] += _start[i];
+
+  // with room to spare, so a rebuild with a few more pairs does not allocate again
+  if( _start[n] > int(_neighbours.capacity()) )
+    _neighbours.reserve(_start[n] + _start[n] / 2);
+  _neighbours.resize(_start[n]);
+  _fill.assign(_start.begin(), _start.end() - 1);
+  for( const auto& p : _pairs ) {
+    _neighbours[_fill[p.first]++]  = p.second;
+    _neighbours[_fill[p.second]++] = p.first;
+  }
+  _end.assign(_start.begin() + 1, _start.end());
+  _start.pop_back();
+  _escaped.reserve(n);
+
+  _rebuilds++;
+}
+
+// boxes from first on came after the last build, they have no list and stay escaped until the next rebuild
+void VerletList::addBoxes(int first) {
+
+  const int n = int(_boxes.size());
+
+  Aabb never;   // no box is inside it
+  for( int k = 0; k < 3; ++k ) {
+    never.lo[k] = std::numeric_limits<float>::max();
+    never.hi[k] = -std::numeric_limits<float>::max();
+  }
+
+  _searchBoxes.resize(n);
+  for( int i = 0; i < first; ++i )
+    _searchBoxes[i] = _is_escaped[i] ? _boxes[i] : _grown[i];
+  for( int i = first; i < n; ++i )
+    _searchBoxes[i] = _boxes[i];
+  _search.build(_searchBoxes);
+
+  _grown.resize(n, never);
+  _start.resize(n, 0);
+  _end.resize(n, 0);
+  _is_escaped.resize(n, 0);
+  for( int i = first; i < n; ++i )
+    escape(i);
+}
+
+void VerletList::dropNeighbour(int id, int neighbour) {
+
+  for( int k = _start[id]; k < _end[id]; ++k )
+    if( _neighbours[k] == neighbour ) {
+      _neighbours[k] = _neighbours[--_end[id]];
+      return;
+    }
+}
+
+void VerletList::escape(int id) {
+
+  if( !_is_escaped[id] ) {
+    _is_escaped[id] = 1;
+    _escaped.push_back(id);
+  }
+  _search.update(id, _boxes[id]);
+}
+
+void VerletList::build(const std::vector<Aabb>& boxes) {
+
+  _boxes = boxes;
+  const int n = int(_boxes.size());
+
+  const int listed = int(_grown.size());
+  bool valid = listed > 0 && listed <= n;
+  if( valid && listed < n )
+    addBoxes(listed);
+  if( valid ) {
+
+    // boxes back inside their grown box are covered by the lists again
+    int kept = 0;
+    for( int id : _escaped ) {
+      if( inside(id) ) {
+        _is_escaped[id] = 0;
+        _search.update(id, _grown[id]);
+      }
+      else {
+        _search.update(id, _boxes[id]);
+        _escaped[kept++] = id;
+      }
+    }
+    _escaped.resize(kept);
+
+    for( int i = 0; i < n; ++i )
+      if( !_is_escaped[i] && !inside(i) )
+        escape(i);
+
+    valid = _escaped.size() <= _max_escaped * n;
+  }
+
+  if( !valid ) {
+    _escaped.clear();
+    _is_escaped.assign(n, 0);
+    rebuild();
+  }
+}
+
+// the next build rebuilds the lists
+void VerletList::reset() {
+
+  _grown.clear();
+  _search.reset();
+}
+
+void VerletList::remove(int id, int last) {
+
+  const int n = int(_grown.size());
+  if( id >= n )
+    return;
+  if( last < n && last != n - 1 ) {   // removes were missed, the ids no longer match
+    reset();
+    return;
+  }
+
+  // the boxes listed with id lose it
+  for( int k = _start[id]; k < _end[id]; ++k )
+    dropNeighbour(_neighbours[k], id);
+
+  // a box added since the last build takes the place of id, it starts escaped with the next build
+  if( last >= n ) {
+    _end[id] = _start[id];
+    for( int k = 0; k < 3; ++k ) {
+      _grown[id].lo[k] = std::numeric_limits<float>::max();
+      _grown[id].hi[k] = -std::numeric_limits<float>::max();
+    }
+    if( !_is_escaped[id] ) {
+      _is_escaped[id] = 1;
+      _escaped.push_back(id);
+    }
+    return;
+  }
+
+  // last takes the id, in its own list and in those of its neighbours
+  if( _is_escaped[id] )
+    _escaped.erase(std::find(_escaped.begin(), _escaped.end(), id));
+  if( last != id ) {
+    for( int k = _start[last]; k < _end[last]; ++k ) {
+      const int j = _neighbours[k];
+      std::replace(_neighbours.begin() + _start[j], _neighbours.begin() + _end[j], last, id);
+    }
+    if( _is_escaped[last] )
+      *std::find(_escaped.begin(), _escaped.end(), last) = id;
+
+    _boxes[id]      = _boxes[last];
+    _grown[id]      = _grown[last];
+    _start[id]      = _start[last];
+    _end[id]        = _end[last];
+    _is_escaped[id] = _is_escaped[last];
+  }
+  _boxes.pop_back();
+  _grown.pop_back();
+  _start.pop_back();
+  _end.pop_back();
+  _is_escaped.pop_back();
+  _search.remove(id, last);
+}
+
+void VerletList::update(int id, const Aabb& box) {
+
+  _boxes[id] = box;
+  if( _is_escaped[id] || !inside(id) )
+    escape(id);
+}
+
+void VerletList::findPairs(std::vector<std::pair<int,int>>& pairs) const {
+
+  pairs.clear();
+
+  const int n = int(_boxes.size());
+  for( int i = 0; i < n; ++i ) {
+    if( _is_escaped[i] )
+      continue;
+    for( int k = _start[i]; k < _end[i]; ++k ) {
+      const int j = _neighbours[k];
+      if( i < j && !_is_escaped[j] && _boxes[i].overlaps(_boxes[j]) )
+        pairs.emplace_back(i, j);
+    }
+  }
+
+  for( int e : _escaped ) {
+    _search.query(e, _found);
+    for( int j : _found )
+      if( (!_is_escaped[j] || e < j) && _boxes[e].overlaps(_boxes[j]) )
+        pairs.emplace_back(std::min(e, j), std::max(e, j));
+  }
+}
+
+void VerletList::query(int id, std::vector<int>& result) {
+
+  result.clear();
+  const Aabb& box = _boxes[id];
+
+  // an escaped box may meet any box whose grown box it reaches
+  if( _is_escaped[id] ) {
+    _search.query(id, result);
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [this, &box](int j) { return !box.overlaps(_boxes[j]); }),
+                 result.end());
+    return;
+  }
+
+  for( int k = _start[id]; k < _end[id]; ++k ) {
+    const int j = _neighbours[k];
+    if( !_is_escaped[j] && box.overlaps(_boxes[j]) )
+      result.push_back(j);
+  }
+  for( int j : _escaped )
+    if( j != id && box.overlaps(_boxes[j]) )
+      result.push_back(j);
+}
@@ -0,0 +1,59 @@
+#ifndef VERLETLIST_H
+#define VERLETLIST_H
+
+#include "sweepandprune.h"
+
+
+// Verlet neighbour lists. Each box keeps the boxes that came within the skin of it,
+// found with a grown copy of the box. While a box stays inside its grown copy its
+// list holds all boxes it can overlap, so in slow scenes the pairs are only searched
+// again every few frames. A box that left its grown copy is escaped: it is searched
+// among the grown boxes with a sweep and prune instead, until so many boxes have
+// escaped that the lists are rebuilt. Boxes removed between frames are taken out of
+// the lists of their neighbours, new boxes start escaped.
+class VerletList : public BroadPhase {
+public:
+  explicit VerletList( float skin = 0.5f );
+
+  void                  setSkin( float skin );
+  float                 getSkin() const;
+
+  void                  build( const std::vector<Aabb>& boxes ) override;
+  void                  update( int id, const Aabb& box ) override;
+  void                  reset() override;
+  void                  remove( int id, int last ) override;
+
+  void                  findPairs( std::vector<std::pair<int,int>>& pairs ) const override;
+  void                  query( int id, std::vector<int>& result ) override;
+
+  void                  setMaxEscaped( float fraction );  // of all boxes, before the lists are rebuilt
+  long                  getRebuildCount() const;
+  double                getAverageListLength() const;   // neighbours per box at the last rebuild
+
+private:
+  float                 _skin;
+  float                 _max_escaped {0.1f};
+  long                  _rebuilds {0};
+
+  std::vector<Aabb>     _boxes;
+  std::vector<Aabb>     _grown;        // boxes of the last rebuild, grown by half the skin
+  mutable SweepAndPrune _search;       // finds the lists, and the neighbours of escaped boxes
+  mutable std::vector<int> _found;
+  std::vector<std::pair<int,int>> _pairs;
+  std::vector<int>      _start;        // neighbours of i are _neighbours[_start[i] .. _end[i])
+  std::vector<int>      _end;
+  std::vector<int>      _fill;
+  std::vector<int>      _neighbours;
+  std::vector<int>      _escaped;      // boxes outside their grown box, the search holds their own box
+  std::vector<char>     _is_escaped;
+  std::vector<Aabb>     _searchBoxes;  // what the search holds, when new boxes are added to it
+
+  bool                  inside( int id ) const;
+  void                  escape( int id );
+  void                  rebuild();
+  void                  addBoxes( int first );
+  void                  dropNeighbour( int id, int neighbour );
+
+}; // END class VerletList
+
+#endif // VERLETLIST_H
@@ -26,6 +26,8 @@ private:
 
 signals:
   void      signGuiViewportChanged( const QString& name, const QRectF& new_geometry );
+  void      signGuiViewVisibilityChanged( const QString& name, bool visible );
+  void      signGuiViewPausedChanged( const QString& name, bool paused );
   void      signFrameReady();
 
   // Relay singals from qml side
@@ -0,0 +1,107 @@
+#include "workerpool.h"
+
+// stl
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(int threads) {
+
+  setThreadCount(threads);
+}
+
+WorkerPool::~WorkerPool() {
+
+  stopThreads();
+}
+
+void WorkerPool::setThreadCount(int threads) {
+
+  if( threads < 1 ) threads = 1;
+  if( threads == getThreadCount() ) return;
+
+  stopThreads();
+
+  _quit = false;
+  _chunks = threads;
+  for( int w = 1; w < threads; ++w )
+    _threads.emplace_back(&WorkerPool::workerLoop, this, w, _round);
+}
+
+int WorkerPool::getThreadCount() const {
+
+  return int(_threads.size()) + 1;
+}
+
+void WorkerPool::stopThreads() {
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _quit = true;
+  }
+  _start.notify_all();
+
+  for( auto& thread : _threads )
+    thread.join();
+  _threads.clear();
+  _chunks = 1;
+}
+
+void WorkerPool::runChunk(int worker) {
+
+  if( _grain > 0 ) {
+    for( int begin = _next.fetch_add(_grain); begin < _n; begin = _next.fetch_add(_grain) )
+      _fn(_job, worker, begin, std::min(begin + _grain, _n));
+    return;
+  }
+
+  const int begin = int((long(_n) * worker) / _chunks);
+  const int end   = int((long(_n) * (worker + 1)) / _chunks);
+  if( begin < end )
+    _fn(_job, worker, begin, end);
+}
+
+void WorkerPool::runChunks(int n, int grain, Trampoline fn, void* job) {
+
+  if( _threads.empty() ) {
+    if( n > 0 ) fn(job, 0, 0, n);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _fn = fn;
+    _job = job;
+    _n = n;
+    _grain = grain;
+    _next = 0;
+    _pending = int(_threads.size());
+    ++_round;
+  }
+  _start.notify_all();
+
+  runChunk(0);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _done.wait(lock, [this]{ return _pending == 0; });
+}
+
+void WorkerPool::workerLoop(int worker, unsigned long seen) {
+
+  for(;;) {
+
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _start.wait(lock, [&]{ return _quit || _round != seen; });
+      if( _quit ) return;
+      seen = _round;
+    }
+
+    runChunk(worker);
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if( --_pending == 0 )
+        _done.notify_one();
+    }
+  }
+}
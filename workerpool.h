@@ -0,0 +1,66 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+// stl
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+// Persistent threads splitting an index range [0,n) in one contiguous chunk per thread,
+// or handing out small chunks to whichever thread is free when the items differ in cost.
+// The calling thread works on the first chunk, so a pool of one thread runs serially.
+class WorkerPool {
+public:
+  explicit WorkerPool( int threads = 1 );
+  ~WorkerPool();
+
+  void                      setThreadCount( int threads );
+  int                       getThreadCount() const;
+
+  // Calls job(worker, begin, end) for every chunk and returns when all are done
+  template <typename F>
+  void                      run( int n, F& job ) {
+    runChunks( n, 0, &WorkerPool::call<F>, &job );
+  }
+
+  // Same, but threads take the next grain indices from a shared counter until all are
+  // taken, so put the expensive items first
+  template <typename F>
+  void                      runDynamic( int n, int grain, F& job ) {
+    runChunks( n, grain < 1 ? 1 : grain, &WorkerPool::call<F>, &job );
+  }
+
+private:
+  typedef void (*Trampoline)( void* job, int worker, int begin, int end );
+
+  std::vector<std::thread>  _threads;
+  std::mutex                _mutex;
+  std::condition_variable   _start;
+  std::condition_variable   _done;
+
+  Trampoline                _fn {nullptr};
+  void*                     _job {nullptr};
+  int                       _n {0};
+  int                       _chunks {1};
+  int                       _grain {0};            // 0: one contiguous chunk per thread
+  std::atomic<int>          _next {0};
+  unsigned long             _round {0};
+  int                       _pending {0};
+  bool                      _quit {false};
+
+  template <typename F>
+  static void               call( void* job, int worker, int begin, int end ) {
+    (*static_cast<F*>(job))( worker, begin, end );
+  }
+
+  void                      runChunks( int n, int grain, Trampoline fn, void* job );
+  void                      runChunk( int worker );
+  void                      workerLoop( int worker, unsigned long seen );
+  void                      stopThreads();
+
+}; // END class WorkerPool
+
+#endif // WORKERPOOL_H